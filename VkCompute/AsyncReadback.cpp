@@ -0,0 +1,261 @@
+#include "AsyncReadback.h"
+#include "VulkanContext.h"
+#include "ComputeBuffer.h"
+#include "Metrics.h"
+#include <memory>
+#include <iostream>
+
+#define MIN_STAGING_SIZE 4096
+
+void AsyncReadback::initialize()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = VulkanContext::Instance().findQueueFamilies().computeFamily.value();
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create readback command pool!");
+    }
+
+    _running = true;
+    _worker = std::thread(&AsyncReadback::workerLoop, this);
+}
+
+void AsyncReadback::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+
+    _wakeup.notify_all();
+
+    if (_worker.joinable())
+    {
+        _worker.join();
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    for (auto staging : _freeStaging)
+    {
+        staging->release();
+        delete staging;
+    }
+
+    for (auto fence : _freeFences)
+    {
+        vkDestroyFence(device, fence, nullptr);
+    }
+
+    _freeStaging.clear();
+    _freeFences.clear();
+    _freeCommandBuffers.clear();
+
+    vkDestroyCommandPool(device, _commandPool, nullptr);
+}
+
+ComputeBuffer *AsyncReadback::acquireStaging(VkDeviceSize size)
+{
+    // smallest free staging buffer that fits, else a new one rounded up to a power of two
+    auto best = _freeStaging.end();
+
+    for (auto it = _freeStaging.begin(); it != _freeStaging.end(); ++it)
+    {
+        if ((*it)->getSize() >= size && (best == _freeStaging.end() || (*it)->getSize() < (*best)->getSize()))
+        {
+            best = it;
+        }
+    }
+
+    if (best != _freeStaging.end())
+    {
+        ComputeBuffer *staging = *best;
+        _freeStaging.erase(best);
+        return staging;
+    }
+
+    VkDeviceSize capacity = MIN_STAGING_SIZE;
+    while (capacity < size)
+    {
+        capacity *= 2;
+    }
+
+    return new ComputeBuffer((uint64_t)capacity, 1, Readback);
+}
+
+void AsyncReadback::read(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const Callback &callback)
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    Request request;
+    request.size = size;
+    request.callback = callback;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        request.staging = acquireStaging(size);
+
+        if (!_freeCommandBuffers.empty())
+        {
+            request.commandBuffer = _freeCommandBuffers.back();
+            _freeCommandBuffers.pop_back();
+            request.fence = _freeFences.back();
+            _freeFences.pop_back();
+        }
+        else
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = _commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+            if (vkAllocateCommandBuffers(device, &allocInfo, &request.commandBuffer) != VK_SUCCESS ||
+                vkCreateFence(device, &fenceInfo, nullptr, &request.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create readback command buffer!");
+            }
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkResetCommandBuffer(request.commandBuffer, 0);
+        vkBeginCommandBuffer(request.commandBuffer, &beginInfo);
+
+        // wait for earlier dispatches and copies on the queue that wrote this range
+        VkBufferMemoryBarrier before{};
+        before.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        before.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        before.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        before.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before.buffer = buffer;
+        before.offset = offset;
+        before.size = size;
+
+        vkCmdPipelineBarrier(request.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 1, &before, 0, nullptr);
+
+        VkBufferCopy region{};
+        region.srcOffset = offset;
+        region.dstOffset = 0;
+        region.size = size;
+        vkCmdCopyBuffer(request.commandBuffer, buffer, request.staging->getBuffer(), 1, &region);
+
+        VkBufferMemoryBarrier after{};
+        after.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        after.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        after.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        after.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        after.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        after.buffer = request.staging->getBuffer();
+        after.offset = 0;
+        after.size = size;
+
+        vkCmdPipelineBarrier(request.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 0, nullptr, 1, &after, 0, nullptr);
+
+        if (vkEndCommandBuffer(request.commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record readback command buffer!");
+        }
+
+        VulkanContext::Instance().submit(request.commandBuffer, request.fence);
+
+        _pending.push_back(request);
+    }
+
+    _wakeup.notify_one();
+}
+
+std::future<std::vector<char>> AsyncReadback::read(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+    auto promise = std::make_shared<std::promise<std::vector<char>>>();
+    std::future<std::vector<char>> future = promise->get_future();
+
+    read(buffer, offset, size, [promise](const void *data, size_t size)
+    {
+        try
+        {
+            const char *bytes = (const char *)data;
+            promise->set_value(std::vector<char>(bytes, bytes + size));
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+
+    return future;
+}
+
+void AsyncReadback::flush()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _drained.wait(lock, [this] { return _pending.empty() && !_busy; });
+}
+
+void AsyncReadback::workerLoop()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    while (true)
+    {
+        Request request;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this] { return !_pending.empty() || !_running; });
+
+            if (_pending.empty())
+            {
+                return;
+            }
+
+            // the queue executes in order, so the oldest request finishes first
+            request = _pending.front();
+            _pending.pop_front();
+            _busy = true;
+        }
+
+        VulkanContext::Instance().waitForFence(request.fence);
+        vkResetFences(device, 1, &request.fence);
+
+        Metrics::Instance().recordDownload((size_t)request.size);
+
+        // a throwing callback must not take the worker down with it, the staging buffer is recycled either way
+        try
+        {
+            request.callback(request.staging->getMapped(), (size_t)request.size);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "readback callback failed: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "readback callback failed" << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _freeStaging.push_back(request.staging);
+            _freeCommandBuffers.push_back(request.commandBuffer);
+            _freeFences.push_back(request.fence);
+            _busy = false;
+        }
+
+        _drained.notify_all();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __VE_ASYNC_READBACK_H__
+#define __VE_ASYNC_READBACK_H__
+
+#include <vulkan/vulkan.h>
+#include "Singleton.h"
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+
+class ComputeBuffer;
+
+// Copies byte ranges of device buffers into host cached staging memory behind the work
+// already submitted to the compute queue. A worker thread waits on the copies and hands
+// the bytes to a callback, so the caller never blocks on the queue.
+class AsyncReadback : public Singleton<AsyncReadback>
+{
+public:
+    typedef std::function<void(const void *data, size_t size)> Callback;
+
+    void initialize();
+
+    void release();
+
+    // callback runs on the readback thread once the copy has landed, anything it throws is logged and dropped
+    void read(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const Callback &callback);
+
+    std::future<std::vector<char>> read(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+    // block until every request submitted so far has completed
+    void flush();
+
+private:
+    struct Request
+    {
+        ComputeBuffer *staging;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        VkDeviceSize size;
+        Callback callback;
+    };
+
+    VkCommandPool _commandPool = VK_NULL_HANDLE;
+    std::vector<ComputeBuffer *> _freeStaging;
+    std::vector<VkCommandBuffer> _freeCommandBuffers;
+    std::vector<VkFence> _freeFences;
+
+    std::deque<Request> _pending;
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::condition_variable _drained;
+    std::thread _worker;
+    bool _running = false;
+    bool _busy = false;
+
+    ComputeBuffer *acquireStaging(VkDeviceSize size);
+
+    void workerLoop();
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include "AutoTuner.h"
+#include "VulkanContext.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+
+#define BENCHMARK_RUNS 5
+
+AutoTuner::AutoTuner(const std::string &profile) : _profile(profile), _deviceKey(getDeviceKey())
+{
+    read();
+}
+
+std::string AutoTuner::getDeviceKey()
+{
+    VkPhysicalDeviceIDProperties idProperties{};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &idProperties;
+
+    vkGetPhysicalDeviceProperties2(VulkanContext::Instance().getPhysicalDevice(), &properties);
+
+    std::ostringstream key;
+    key << std::hex << std::setfill('0');
+
+    for (uint32_t i = 0; i != VK_UUID_SIZE; ++i)
+    {
+        key << std::setw(2) << (uint32_t)idProperties.deviceUUID[i];
+    }
+
+    key << "-" << std::setw(8) << properties.properties.driverVersion;
+
+    return key.str();
+}
+
+std::vector<TuneConfig> AutoTuner::workgroupSizes(uint32_t localSizeId)
+{
+    const VkPhysicalDeviceLimits &limits = VulkanContext::Instance().getProperties().limits;
+    uint32_t maxSize = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
+
+    std::vector<TuneConfig> candidates;
+
+    for (uint32_t size = 32; size <= maxSize && size <= 1024; size *= 2)
+    {
+        candidates.push_back({{localSizeId, size}});
+    }
+
+    return candidates;
+}
+
+void AutoTuner::read()
+{
+    std::ifstream file(_profile);
+    std::string line;
+
+    // <device> <key> <id>=<value>,... <seconds>
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string device, key, config;
+        double seconds;
+
+        if (!(fields >> device >> key >> config >> seconds) || device != _deviceKey)
+        {
+            continue;
+        }
+
+        TuneResult result;
+        result.seconds = seconds;
+        result.fromProfile = true;
+
+        std::istringstream constants(config);
+        std::string constant;
+
+        while (std::getline(constants, constant, ','))
+        {
+            size_t separator = constant.find('=');
+
+            if (separator != std::string::npos)
+            {
+                result.config[(uint32_t)std::stoul(constant.substr(0, separator))] = (uint32_t)std::stoul(constant.substr(separator + 1));
+            }
+        }
+
+        _entries[key] = result;
+    }
+}
+
+void AutoTuner::save()
+{
+    // keep the entries of other devices, replace ours
+    std::vector<std::string> lines;
+
+    {
+        std::ifstream file(_profile);
+        std::string line;
+
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, _deviceKey.size() + 1, _deviceKey + " ") != 0)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    for (const auto &it : _entries)
+    {
+        std::ostringstream line;
+        line << _deviceKey << " " << it.first << " ";
+
+        for (auto constant = it.second.config.begin(); constant != it.second.config.end(); ++constant)
+        {
+            line << (constant == it.second.config.begin() ? "" : ",") << constant->first << "=" << constant->second;
+        }
+
+        line << " " << it.second.seconds;
+        lines.push_back(line.str());
+    }
+
+    std::ofstream file(_profile, std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to write tuning profile!");
+    }
+
+    for (const auto &line : lines)
+    {
+        file << line << "\n";
+    }
+}
+
+ComputeShader *AutoTuner::create(const std::string &filename, const TuneConfig &config)
+{
+    ComputeShader *shader = new ComputeShader(filename, "main", true);
+
+    for (const auto &constant : config)
+    {
+        shader->setSpecialization(constant.first, constant.second);
+    }
+
+    shader->compile();
+
+    return shader;
+}
+
+ComputeShader *AutoTuner::load(const std::string &filename, const std::string &key, const std::vector<TuneConfig> &candidates,
+                               const TuneWorkload &workload, TuneResult *result)
+{
+    if (key.find_first_of(" \t\n") != std::string::npos)
+    {
+        throw std::runtime_error("tuning key must not contain whitespace!");
+    }
+
+    auto it = _entries.find(key);
+
+    if (it == _entries.end())
+    {
+        TuneResult best;
+        best.seconds = std::numeric_limits<double>::max();
+
+        for (const auto &config : candidates)
+        {
+            ComputeShader *shader = create(filename, config);
+            double seconds = benchmark(shader, config, workload);
+            shader->release();
+            delete shader;
+
+            if (seconds < best.seconds)
+            {
+                best.config = config;
+                best.seconds = seconds;
+            }
+        }
+
+        if (candidates.empty())
+        {
+            throw std::runtime_error("failed to tune, no candidates!");
+        }
+
+        it = _entries.insert(std::make_pair(key, best)).first;
+        save();
+    }
+
+    if (result != nullptr)
+    {
+        *result = it->second;
+    }
+
+    return create(filename, it->second.config);
+}
+
+double AutoTuner::benchmark(ComputeShader *shader, const TuneConfig &config, const TuneWorkload &workload)
+{
+    VulkanContext &context = VulkanContext::Instance();
+    VkDevice device = context.device;
+
+    workload.bind(shader);
+
+    uint32_t x = 1, y = 1, z = 1;
+    workload.groups(config, x, y, z);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(context.getPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(context.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[context.findQueueFamilies().computeFamily.value()].timestampValidBits;
+
+    if (validBits == 0)
+    {
+        throw std::runtime_error("compute queue does not support timestamps!");
+    }
+
+    // only the low validBits of a timestamp count, the counter wraps around there
+    uint64_t mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    auto cleanup = [&]()
+    {
+        if (descriptorSet != VK_NULL_HANDLE)
+        {
+            shader->freeDescriptorSet(descriptorSet);
+        }
+
+        if (cmd != VK_NULL_HANDLE)
+        {
+            context.freeCommandBuffer(cmd);
+        }
+
+        vkDestroyFence(device, fence, nullptr);
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    };
+
+    double best = std::numeric_limits<double>::max();
+
+    try
+    {
+        VkQueryPoolCreateInfo queryInfo{};
+        queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryInfo.queryCount = 2;
+
+        if (vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create benchmark fence!");
+        }
+
+        cmd = context.allocateCommandBuffer();
+        descriptorSet = shader->snapshotDescriptorSet();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        vkBeginCommandBuffer(cmd, &beginInfo);
+
+        vkCmdResetQueryPool(cmd, queryPool, 0, 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+
+        shader->record(cmd, x, y, z, descriptorSet);
+
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record benchmark command buffer!");
+        }
+
+        // the first run warms caches and clocks and is not counted
+        for (int run = 0; run <= BENCHMARK_RUNS; ++run)
+        {
+            context.submit(cmd, fence);
+            context.waitForFence(fence);
+            vkResetFences(device, 1, &fence);
+
+            uint64_t ticks[2];
+
+            if (vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to read benchmark timestamps!");
+            }
+
+            uint64_t elapsed = ((ticks[1] & mask) - (ticks[0] & mask)) & mask;
+            double seconds = (double)elapsed * context.getProperties().limits.timestampPeriod * 1e-9;
+
+            if (run != 0)
+            {
+                best = std::min(best, seconds);
+            }
+        }
+    }
+    catch (...)
+    {
+        cleanup();
+        throw;
+    }
+
+    cleanup();
+
+    return best;
+}
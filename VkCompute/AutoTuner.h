@@ -0,0 +1,65 @@
+#ifndef __VE_AUTO_TUNER_H__
+#define __VE_AUTO_TUNER_H__
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+
+
+class ComputeShader;
+
+// specialization constant id -> value, e.g. {{0, 128}} for local_size_x_id = 0
+typedef std::map<uint32_t, uint32_t> TuneConfig;
+
+struct TuneWorkload
+{
+    // set buffers and uniforms of a candidate shader
+    std::function<void(ComputeShader *shader)> bind;
+
+    // thread groups covering the problem with a candidate configuration
+    std::function<void(const TuneConfig &config, uint32_t &x, uint32_t &y, uint32_t &z)> groups;
+};
+
+struct TuneResult
+{
+    TuneConfig config;
+    double seconds = 0.0;
+    bool fromProfile = false;
+};
+
+// Benchmarks specialization candidates of a shader with GPU timestamps and keeps the winner in a profile file.
+// Profile entries are keyed by device UUID, driver version and a caller chosen key (kernel and problem size),
+// so a driver update or another GPU triggers a new search.
+class AutoTuner
+{
+public:
+    explicit AutoTuner(const std::string &profile);
+
+    // compiled shader specialised with the best candidate for key, benchmarked and saved when not in the profile
+    ComputeShader *load(const std::string &filename, const std::string &key, const std::vector<TuneConfig> &candidates,
+                        const TuneWorkload &workload, TuneResult *result = nullptr);
+
+    // best of several dispatches timed with GPU timestamps, in seconds; throws when the compute queue has none
+    double benchmark(ComputeShader *shader, const TuneConfig &config, const TuneWorkload &workload);
+
+    void save();
+
+    // hex device UUID and driver version of the current physical device
+    static std::string getDeviceKey();
+
+    // local_size_x candidates from 32 to the device limit, for shaders declaring local_size_x_id = 0
+    static std::vector<TuneConfig> workgroupSizes(uint32_t localSizeId = 0);
+
+private:
+    std::string _profile;
+    std::string _deviceKey;
+    std::map<std::string, TuneResult> _entries;
+
+    void read();
+
+    ComputeShader *create(const std::string &filename, const TuneConfig &config);
+};
+
+#endif
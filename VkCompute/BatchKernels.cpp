@@ -0,0 +1,222 @@
+#include "BatchKernels.h"
+#include "SegmentBatch.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <stdexcept>
+
+BatchKernels::BatchKernels(const std::string &shaderDirectory)
+{
+    _add = new ComputeShader(shaderDirectory + "BatchAdd.csv");
+    _reduce = new ComputeShader(shaderDirectory + "BatchReduce.csv");
+    _matvec = new ComputeShader(shaderDirectory + "BatchMatVec.csv");
+}
+
+void BatchKernels::add(SegmentBatch &in, const std::vector<float> &values, SegmentBatch &out)
+{
+    uint32_t segmentCount = in.getSegmentCount();
+
+    if (values.size() != segmentCount)
+    {
+        throw std::runtime_error("batched add needs one value per segment!");
+    }
+
+    out.clear();
+
+    for (uint32_t s = 0; s != segmentCount; ++s)
+    {
+        out.reserve(in.getCount(s));
+    }
+
+    if (segmentCount == 0)
+    {
+        return;
+    }
+
+    in.upload();
+    out.upload();
+
+    ComputeBuffer *scalars = reserveScalars(segmentCount);
+    scalars->setData((void *)values.data(), segmentCount);
+
+    dispatch(_add, segmentCount, {{"BatchIn", in.getValues()},
+                                  {"BatchOffsets", in.getOffsets()},
+                                  {"BatchOut", out.getValues()},
+                                  {"BatchValues", scalars}});
+
+    out.download();
+}
+
+std::vector<float> BatchKernels::reduce(SegmentBatch &in)
+{
+    uint32_t segmentCount = in.getSegmentCount();
+    std::vector<float> sums(segmentCount);
+
+    if (segmentCount == 0)
+    {
+        return sums;
+    }
+
+    in.upload();
+
+    ComputeBuffer *scalars = reserveScalars(segmentCount);
+
+    dispatch(_reduce, segmentCount, {{"BatchIn", in.getValues()},
+                                     {"BatchOffsets", in.getOffsets()},
+                                     {"BatchSums", scalars}});
+
+    scalars->getData(sums.data(), segmentCount);
+
+    return sums;
+}
+
+void BatchKernels::matvec(SegmentBatch &matrices, SegmentBatch &vectors, SegmentBatch &out)
+{
+    uint32_t segmentCount = matrices.getSegmentCount();
+
+    if (vectors.getSegmentCount() != segmentCount)
+    {
+        throw std::runtime_error("batched matvec needs one vector per matrix!");
+    }
+
+    out.clear();
+
+    for (uint32_t s = 0; s != segmentCount; ++s)
+    {
+        uint32_t cols = vectors.getCount(s);
+
+        if (cols == 0 ? matrices.getCount(s) != 0 : matrices.getCount(s) % cols != 0)
+        {
+            throw std::runtime_error("matrix size is not a multiple of the vector size!");
+        }
+
+        out.reserve(cols == 0 ? 0 : matrices.getCount(s) / cols);
+    }
+
+    if (segmentCount == 0)
+    {
+        return;
+    }
+
+    matrices.upload();
+    vectors.upload();
+    out.upload();
+
+    dispatch(_matvec, segmentCount, {{"BatchMatrices", matrices.getValues()},
+                                     {"BatchMatrixOffsets", matrices.getOffsets()},
+                                     {"BatchVectors", vectors.getValues()},
+                                     {"BatchVectorOffsets", vectors.getOffsets()},
+                                     {"BatchOut", out.getValues()},
+                                     {"BatchOutOffsets", out.getOffsets()}});
+
+    out.download();
+}
+
+ComputeBuffer* BatchKernels::reserveScalars(uint32_t count)
+{
+    if (_scalars == nullptr || _scalars->getCount() < count)
+    {
+        if (_scalars != nullptr)
+        {
+            _scalars->release();
+            delete _scalars;
+        }
+
+        _scalars = new ComputeBuffer(std::max(count, 256u), 4, Dynamic);
+    }
+
+    return _scalars;
+}
+
+void BatchKernels::setMaxGroupsX(uint32_t maxGroupsX)
+{
+    _maxGroupsX = maxGroupsX;
+}
+
+void BatchKernels::dispatch(ComputeShader *shader, uint32_t segmentCount, const std::map<std::string, ComputeBuffer*> &buffers)
+{
+    if (_commandBuffer == VK_NULL_HANDLE)
+    {
+        _commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(VulkanContext::Instance().device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create batch fence!");
+        }
+    }
+
+    // one workgroup per segment, folded into y past the grid limit; Batch.glsl skips the padding groups
+    uint32_t maxGroupsX = VulkanContext::Instance().getProperties().limits.maxComputeWorkGroupCount[0];
+
+    if (_maxGroupsX != 0)
+    {
+        maxGroupsX = std::min(maxGroupsX, _maxGroupsX);
+    }
+
+    uint32_t groupsX = std::min(segmentCount, maxGroupsX);
+    uint32_t groupsY = (segmentCount + groupsX - 1) / groupsX;
+
+    // the shader's own bindings stay as the caller set them, every batch gets a descriptor set of its own
+    VkDescriptorSet descriptorSet = shader->allocateDescriptorSet(buffers);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(_commandBuffer, 0);
+
+    if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        shader->freeDescriptorSet(descriptorSet);
+        throw std::runtime_error("failed to begin recording batch command buffer!");
+    }
+
+    shader->record(_commandBuffer, groupsX, groupsY, 1, descriptorSet, &segmentCount);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
+    {
+        shader->freeDescriptorSet(descriptorSet);
+        throw std::runtime_error("failed to record batch command buffer!");
+    }
+
+    VulkanContext::Instance().submit(_commandBuffer, _fence);
+    VulkanContext::Instance().waitForFence(_fence);
+    vkResetFences(VulkanContext::Instance().device, 1, &_fence);
+
+    shader->freeDescriptorSet(descriptorSet);
+}
+
+void BatchKernels::release()
+{
+    for (ComputeShader *shader : {_add, _reduce, _matvec})
+    {
+        shader->release();
+        delete shader;
+    }
+
+    if (_scalars != nullptr)
+    {
+        _scalars->release();
+        delete _scalars;
+        _scalars = nullptr;
+    }
+
+    if (_commandBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFence(VulkanContext::Instance().device, _fence, nullptr);
+        VulkanContext::Instance().freeCommandBuffer(_commandBuffer);
+    }
+
+    _commandBuffer = VK_NULL_HANDLE;
+    _fence = VK_NULL_HANDLE;
+}
@@ -0,0 +1,55 @@
+#ifndef __VE_BATCH_KERNELS_H__
+#define __VE_BATCH_KERNELS_H__
+
+#include <vulkan/vulkan.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+class ComputeShader;
+class ComputeBuffer;
+class SegmentBatch;
+
+// Elementwise, reduce and matvec over every segment of a SegmentBatch in a single dispatch,
+// so thousands of tiny requests cost one submit instead of one each. See res/shaders/Batch*.comp.
+class BatchKernels
+{
+public:
+    explicit BatchKernels(const std::string &shaderDirectory = "../res/shaders/");
+
+    // out[s][i] = in[s][i] + values[s]; out is cleared and shaped like in, results are downloaded
+    void add(SegmentBatch &in, const std::vector<float> &values, SegmentBatch &out);
+
+    // sum of every segment
+    std::vector<float> reduce(SegmentBatch &in);
+
+    // out[s] = matrices[s] * vectors[s] with matrices[s] row-major; out is cleared and shaped, results are downloaded
+    void matvec(SegmentBatch &matrices, SegmentBatch &vectors, SegmentBatch &out);
+
+    // widest row of the dispatch grid, 0 uses maxComputeWorkGroupCount[0]; segments past it fold into more rows
+    void setMaxGroupsX(uint32_t maxGroupsX);
+
+    void release();
+
+private:
+    ComputeShader *_add;
+    ComputeShader *_reduce;
+    ComputeShader *_matvec;
+
+    // per segment scalars in and out
+    ComputeBuffer *_scalars = nullptr;
+
+    uint32_t _maxGroupsX = 0;
+
+    // every call records and waits on its own command buffer, the global one is left to the caller
+    VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+    VkFence _fence = VK_NULL_HANDLE;
+
+    ComputeBuffer* reserveScalars(uint32_t count);
+
+    void dispatch(ComputeShader *shader, uint32_t segmentCount, const std::map<std::string, ComputeBuffer*> &buffers);
+};
+
+#endif
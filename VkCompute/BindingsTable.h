@@ -48,6 +48,17 @@ public:
         return (float)atof(_rows[i][3].c_str());
     }
 
+    inline std::string getValueString(int i)
+    {
+        return _rows[i].size() > 3 ? _rows[i][3] : "";
+    }
+
+    // optional fifth column of buffer rows: readonly, writeonly or empty for read-write
+    inline std::string getAccess(int i)
+    {
+        return _rows[i].size() > 4 ? _rows[i][4] : "";
+    }
+
 private:
     std::vector<std::vector<std::string>> _rows;
 
@@ -0,0 +1,159 @@
+#include "BindlessHeap.h"
+#include "VulkanContext.h"
+#include "ComputeBuffer.h"
+#include <algorithm>
+
+#define MAX_BINDLESS_BUFFERS 65536
+
+void BindlessHeap::initialize()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+
+    vkGetPhysicalDeviceProperties2(VulkanContext::Instance().getPhysicalDevice(), &properties);
+
+    _capacity = std::min<uint32_t>({MAX_BINDLESS_BUFFERS,
+                                    indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                    indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = _capacity;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                               VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                               VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 1;
+    flagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &_layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = _capacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &_pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo{};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = _pool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &_layout;
+
+    if (vkAllocateDescriptorSets(device, &allocateInfo, &_descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+}
+
+void BindlessHeap::release()
+{
+    if (!isAvailable())
+    {
+        return;
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    vkDestroyDescriptorPool(device, _pool, nullptr);
+    vkDestroyDescriptorSetLayout(device, _layout, nullptr);
+
+    _pool = VK_NULL_HANDLE;
+    _layout = VK_NULL_HANDLE;
+    _descriptorSet = VK_NULL_HANDLE;
+    _next = 0;
+    _free.clear();
+}
+
+uint32_t BindlessHeap::add(ComputeBuffer *buffer)
+{
+    if (!isAvailable())
+    {
+        throw std::runtime_error("bindless buffers need VK_EXT_descriptor_indexing!");
+    }
+
+    if (buffer->getSize() > VulkanContext::Instance().getProperties().limits.maxStorageBufferRange)
+    {
+        throw std::runtime_error("buffer is larger than maxStorageBufferRange, it cannot be bindless!");
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint32_t index;
+
+    if (!_free.empty())
+    {
+        index = _free.back();
+        _free.pop_back();
+    }
+    else if (_next < _capacity)
+    {
+        index = _next++;
+    }
+    else
+    {
+        throw std::runtime_error("bindless heap is full!");
+    }
+
+    update(index, buffer);
+
+    return index;
+}
+
+void BindlessHeap::update(uint32_t index, ComputeBuffer *buffer)
+{
+    if (buffer->getDescriptor()->range > VulkanContext::Instance().getProperties().limits.maxStorageBufferRange)
+    {
+        throw std::runtime_error("bindless buffer range is larger than maxStorageBufferRange!");
+    }
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = _descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = buffer->getDescriptor();
+
+    vkUpdateDescriptorSets(VulkanContext::Instance().device, 1, &write, 0, nullptr);
+}
+
+void BindlessHeap::remove(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // partially bound, the stale descriptor is never read again
+    _free.push_back(index);
+}
@@ -0,0 +1,62 @@
+#ifndef __VE_BINDLESS_HEAP_H__
+#define __VE_BINDLESS_HEAP_H__
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include "Singleton.h"
+
+
+class ComputeBuffer;
+
+// One update-after-bind array of storage buffers shared by all bindless shaders, bound as set 1.
+// Buffers get a slot from ComputeBuffer::getBindlessIndex() and kernels pick them by index from push constants,
+// see res/shaders/Bindless.glsl. Needs VK_EXT_descriptor_indexing, VulkanContext initializes it when supported.
+class BindlessHeap : public Singleton<BindlessHeap>
+{
+public:
+    void initialize();
+
+    void release();
+
+    inline bool isAvailable() const
+    {
+        return _descriptorSet != VK_NULL_HANDLE;
+    }
+
+    // slot written immediately, usable by command buffers recorded earlier as long as they run after this call
+    uint32_t add(ComputeBuffer *buffer);
+
+    // point a slot at the current VkBuffer of buffer, after it was recreated
+    void update(uint32_t index, ComputeBuffer *buffer);
+
+    // the slot is reused by later add() calls, it must not be read by pending work any more
+    void remove(uint32_t index);
+
+    inline VkDescriptorSetLayout getLayout() const
+    {
+        return _layout;
+    }
+
+    inline VkDescriptorSet getDescriptorSet() const
+    {
+        return _descriptorSet;
+    }
+
+    inline uint32_t getCapacity() const
+    {
+        return _capacity;
+    }
+
+private:
+    VkDescriptorSetLayout _layout = VK_NULL_HANDLE;
+    VkDescriptorPool _pool = VK_NULL_HANDLE;
+    VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+    uint32_t _capacity = 0;
+
+    std::mutex _mutex;
+    uint32_t _next = 0;
+    std::vector<uint32_t> _free;
+};
+
+#endif
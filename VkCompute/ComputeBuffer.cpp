@@ -1,14 +1,149 @@
 #include "ComputeBuffer.h"
 #include "VulkanContext.h"
+#include "AsyncReadback.h"
+#include "Metrics.h"
+#include "BindlessHeap.h"
+#include "ResidencyManager.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-ComputeBuffer::ComputeBuffer(int count, int stride, ComputeBufferMode usage) : _count(count), _stride(stride)
+#define DEFAULT_HOST_ALIGNMENT 4096
+
+#define FILE_CHUNK_SIZE (64 * 1024 * 1024)
+#define FILE_STAGING_SLOTS 3
+
+#ifndef _WIN32
+namespace
+{
+    // release the file on every way out of createFromFile
+    struct FileGuard
+    {
+        int fd = -1;
+        void* mapping = MAP_FAILED;
+        size_t length = 0;
+
+        ~FileGuard()
+        {
+            if (mapping != MAP_FAILED)
+            {
+                munmap(mapping, length);
+            }
+
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    };
+}
+#endif
+
+ComputeBuffer::ComputeBuffer(uint64_t count, int stride, ComputeBufferMode usage) : _count(count), _stride(stride), _usage(usage)
+{
+    allocate();
+}
+
+ComputeBuffer::ComputeBuffer(uint64_t count, int stride, ComputeBufferMode usage, VkExternalMemoryHandleTypeFlags handleTypes, int importFd,
+                             uint32_t memoryTypeIndex, VkDeviceSize allocationSize)
+    : _count(count), _stride(stride), _usage(usage), _memoryTypeIndex(memoryTypeIndex), _allocationSize(allocationSize),
+      _externalHandleTypes(handleTypes), _importFd(importFd)
+{
+    if (!VulkanContext::Instance().isExtensionEnabled(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME))
+    {
+        throw std::runtime_error("sharing buffers needs VK_KHR_external_memory_fd!");
+    }
+
+    allocate();
+
+    // the import consumed the descriptor
+    _importFd = -1;
+}
+
+ComputeBuffer* ComputeBuffer::createExportable(uint64_t count, int stride, ComputeBufferMode usage)
+{
+    return new ComputeBuffer(count, stride, usage, VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT, -1);
+}
+
+ComputeBuffer* ComputeBuffer::importFd(int fd, uint64_t count, int stride, ComputeBufferMode usage, uint32_t memoryTypeIndex, VkDeviceSize allocationSize)
+{
+    return new ComputeBuffer(count, stride, usage, VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT, fd, memoryTypeIndex, allocationSize);
+}
+
+int ComputeBuffer::exportFd()
+{
+    if (_externalHandleTypes == 0)
+    {
+        throw std::runtime_error("buffer was not created exportable!");
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+    auto getMemoryFd = (PFN_vkGetMemoryFdKHR)vkGetDeviceProcAddr(device, "vkGetMemoryFdKHR");
+
+    VkMemoryGetFdInfoKHR getFdInfo{};
+    getFdInfo.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+    getFdInfo.memory = _bufferMemory;
+    getFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+    int fd = -1;
+
+    if (getMemoryFd == nullptr || getMemoryFd(device, &getFdInfo, &fd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to export buffer memory!");
+    }
+
+    return fd;
+}
+
+void ComputeBuffer::allocate()
 {
     VkDevice device = VulkanContext::Instance().device;
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    bool dedicated = false;
+
+    if (_externalHandleTypes != 0)
+    {
+        VkPhysicalDeviceExternalBufferInfo externalBufferInfo{};
+        externalBufferInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO;
+        externalBufferInfo.usage = usage;
+        externalBufferInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+        VkExternalBufferProperties externalProperties{};
+        externalProperties.sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES;
+
+        vkGetPhysicalDeviceExternalBufferProperties(VulkanContext::Instance().getPhysicalDevice(), &externalBufferInfo, &externalProperties);
+
+        VkExternalMemoryFeatureFlags features = externalProperties.externalMemoryProperties.externalMemoryFeatures;
+
+        if (_importFd >= 0 && (features & VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT) == 0)
+        {
+            throw std::runtime_error("device cannot import buffer memory from a file descriptor!");
+        }
+
+        if (_importFd < 0 && (features & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT) == 0)
+        {
+            throw std::runtime_error("device cannot export buffer memory as a file descriptor!");
+        }
+
+        dedicated = (features & VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT) != 0;
+    }
+
+    VkExternalMemoryBufferCreateInfo externalInfo{};
+    externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = _externalHandleTypes;
 
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = count * stride;
-    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.pNext = _externalHandleTypes != 0 ? &externalInfo : nullptr;
+    bufferInfo.size = (VkDeviceSize)_count * _stride;
+    bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     if (vkCreateBuffer(device, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS)
@@ -19,6 +154,13 @@ ComputeBuffer::ComputeBuffer(int count, int stride, ComputeBufferMode usage) : _
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device, _buffer, &memRequirements);
 
+    // setData, getData and the mapping all assume count * stride bytes behind the buffer
+    if (memRequirements.size < bufferInfo.size)
+    {
+        vkDestroyBuffer(device, _buffer, nullptr);
+        throw std::runtime_error("buffer memory requirements are smaller than the buffer!");
+    }
+
     VkMemoryPropertyFlags properties =
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | // 允许 CPU 写入
         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; // 保持内存可见一致性，内存映射后立即开始写入
@@ -26,45 +168,667 @@ ComputeBuffer::ComputeBuffer(int count, int stride, ComputeBufferMode usage) : _
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, properties);
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &_bufferMemory) != VK_SUCCESS)
+    VkExportMemoryAllocateInfo exportInfo{};
+    exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
+    exportInfo.handleTypes = _externalHandleTypes;
+
+    VkImportMemoryFdInfoKHR importInfo{};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+    importInfo.fd = _importFd;
+
+    // the driver only exports or imports this memory as an allocation dedicated to one buffer
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = _buffer;
+
+    if (dedicated)
+    {
+        exportInfo.pNext = &dedicatedInfo;
+        importInfo.pNext = &dedicatedInfo;
+    }
+
+    if (_importFd >= 0)
+    {
+        // an opaque fd is imported with exactly the memory type and size the exporter allocated
+        if (_memoryTypeIndex >= VulkanContext::Instance().getMemoryProperties().memoryTypeCount ||
+            (memRequirements.memoryTypeBits & (1u << _memoryTypeIndex)) == 0 || _allocationSize < memRequirements.size)
+        {
+            vkDestroyBuffer(device, _buffer, nullptr);
+            throw std::runtime_error("imported memory does not fit the buffer!");
+        }
+
+        allocInfo.pNext = &importInfo;
+        allocInfo.allocationSize = _allocationSize;
+        allocInfo.memoryTypeIndex = _memoryTypeIndex;
+    }
+    else
+    {
+        if (_externalHandleTypes != 0)
+        {
+            allocInfo.pNext = &exportInfo;
+        }
+
+        if (_usage == DeviceLocal)
+        {
+            allocInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        else if (_usage == Readback)
+        {
+            // 回读走 CPU 缓存的内存更快，没有时退回普通的 host visible 内存
+            try
+            {
+                allocInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, properties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+            }
+            catch (const std::runtime_error &)
+            {
+                allocInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, properties);
+            }
+        }
+        else
+        {
+            allocInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, properties);
+        }
+    }
+
+    VkResult result = VulkanContext::Instance().allocateMemory(allocInfo, &_bufferMemory);
+
+    // make room by evicting idle managed buffers before giving up
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && ResidencyManager::Instance().evict(memRequirements.size) != 0)
     {
+        result = VulkanContext::Instance().allocateMemory(allocInfo, &_bufferMemory);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, _buffer, nullptr);
         throw std::runtime_error("failed to allocate buffer memory!");
     }
 
+    if (vkBindBufferMemory(device, _buffer, _bufferMemory, 0) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, _buffer, nullptr);
+        VulkanContext::Instance().freeMemory(_bufferMemory);
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+
+    if ((_usage == Staging || _usage == Readback) && vkMapMemory(device, _bufferMemory, 0, VK_WHOLE_SIZE, 0, &_mapped) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, _buffer, nullptr);
+        VulkanContext::Instance().freeMemory(_bufferMemory);
+        throw std::runtime_error("failed to map buffer memory!");
+    }
+
+    _memoryTypeIndex = allocInfo.memoryTypeIndex;
+    _allocationSize = allocInfo.allocationSize;
+
+    _storageBufferInfo.buffer = _buffer;
+    _storageBufferInfo.offset = 0;
+    _storageBufferInfo.range = (VkDeviceSize)_count * _stride;
+}
+
+ComputeBuffer::ComputeBuffer(void *hostPointer, uint64_t count, int stride) : _count(count), _stride(stride), _usage(Immutable)
+{
+    if (!importHost(hostPointer))
+    {
+        // 不支持导入时退回普通的拷贝路径
+        allocate();
+        setData(hostPointer, count);
+    }
+}
+
+bool ComputeBuffer::importHost(void *hostPointer)
+{
+    VkDevice device = VulkanContext::Instance().device;
+    VkDeviceSize alignment = VulkanContext::Instance().getHostPointerAlignment();
+    VkDeviceSize size = (VkDeviceSize)_count * _stride;
+
+    if (alignment == 0 || (uintptr_t)hostPointer % alignment != 0 || size % alignment != 0)
+    {
+        return false;
+    }
+
+    auto getHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(device, "vkGetMemoryHostPointerPropertiesEXT");
+
+    VkMemoryHostPointerPropertiesEXT pointerProperties{};
+    pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+
+    if (getHostPointerProperties == nullptr ||
+        getHostPointerProperties(device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, hostPointer, &pointerProperties) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkExternalMemoryBufferCreateInfo externalInfo{};
+    externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = &externalInfo;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, _buffer, &memRequirements);
+
+    // a host visible, coherent type the buffer and the pointer both accept
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t typeBits = memRequirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(VulkanContext::Instance().getPhysicalDevice(), &memProperties);
+
+    uint32_t typeIndex = UINT32_MAX;
+    for (uint32_t i = 0; i != memProperties.memoryTypeCount; ++i)
+    {
+        if ((typeBits & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            typeIndex = i;
+            break;
+        }
+    }
+
+    VkImportMemoryHostPointerInfoEXT importInfo{};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = hostPointer;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &importInfo;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = typeIndex;
+
+    if (typeIndex == UINT32_MAX || VulkanContext::Instance().allocateMemory(allocInfo, &_bufferMemory) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, _buffer, nullptr);
+        _buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
     vkBindBufferMemory(device, _buffer, _bufferMemory, 0);
 
+    _mapped = hostPointer;
+    _imported = true;
+
     _storageBufferInfo.buffer = _buffer;
     _storageBufferInfo.offset = 0;
-    _storageBufferInfo.range = stride * count;
+    _storageBufferInfo.range = size;
+
+    return true;
+}
+
+VkDeviceSize ComputeBuffer::getHostAlignment()
+{
+    VkDeviceSize alignment = VulkanContext::Instance().getHostPointerAlignment();
+    return alignment != 0 ? alignment : DEFAULT_HOST_ALIGNMENT;
+}
+
+void* ComputeBuffer::allocateHost(size_t size)
+{
+    size_t alignment = (size_t)getHostAlignment();
+    size = (size + alignment - 1) / alignment * alignment;
+
+#ifdef _WIN32
+    void *pointer = _aligned_malloc(size, alignment);
+#else
+    void *pointer = nullptr;
+    if (posix_memalign(&pointer, alignment, size) != 0)
+    {
+        pointer = nullptr;
+    }
+#endif
+
+    if (pointer == nullptr)
+    {
+        throw std::runtime_error("failed to allocate host memory!");
+    }
+
+    return pointer;
+}
+
+void ComputeBuffer::freeHost(void *pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    free(pointer);
+#endif
 }
 
-void ComputeBuffer::setData(void* array, int count, int srcOffset, int dstOffset)
+void ComputeBuffer::setData(void* array, uint64_t count, uint64_t srcOffset, uint64_t dstOffset)
 {
+    if (_usage == DeviceLocal)
+    {
+        throw std::runtime_error("device local buffer is not host visible!");
+    }
+
+    if (_evicted != nullptr)
+    {
+        ResidencyManager::Instance().use({this});
+    }
+
+    char* buffer = (char*)array;
+    buffer += (size_t)srcOffset * _stride;
+
+    Metrics::Instance().recordUpload((size_t)count * _stride);
+
+    if (_mapped != nullptr)
+    {
+        memcpy((char*)_mapped + (size_t)dstOffset * _stride, buffer, (size_t)count * _stride);
+        return;
+    }
+
     VkDevice device = VulkanContext::Instance().device;
     void *data;
-    vkMapMemory(device, _bufferMemory, dstOffset * _stride, _count * _stride, 0, &data);
-    char* buffer = (char*)array;
-    buffer += _stride * srcOffset;
-    memcpy(data, buffer, count * _stride);
+    vkMapMemory(device, _bufferMemory, (VkDeviceSize)dstOffset * _stride, (VkDeviceSize)count * _stride, 0, &data);
+    memcpy(data, buffer, (size_t)count * _stride);
     vkUnmapMemory(device, _bufferMemory);
 }
 
-void ComputeBuffer::getData(void *array, int count, int srcOffset, int dstOffset)
+void ComputeBuffer::getData(void *array, uint64_t count, uint64_t srcOffset, uint64_t dstOffset)
 {
+    if (_usage == DeviceLocal)
+    {
+        throw std::runtime_error("device local buffer is not host visible!");
+    }
+
+    if (_evicted != nullptr)
+    {
+        ResidencyManager::Instance().use({this});
+    }
+
+    char* buffer = (char*)array;
+    buffer += (size_t)dstOffset * _stride;
+
+    Metrics::Instance().recordDownload((size_t)count * _stride);
+
+    if (_mapped != nullptr)
+    {
+        memcpy(buffer, (char*)_mapped + (size_t)srcOffset * _stride, (size_t)count * _stride);
+        return;
+    }
+
     VkDevice device = VulkanContext::Instance().device;
     void *data;
-    vkMapMemory(device, _bufferMemory, srcOffset * _stride, _count * _stride, 0, &data);
-    char* buffer = (char*)array;
-    buffer += _stride * dstOffset;
-    memcpy(buffer, data, count * _stride);
+    vkMapMemory(device, _bufferMemory, (VkDeviceSize)srcOffset * _stride, (VkDeviceSize)count * _stride, 0, &data);
+    memcpy(buffer, data, (size_t)count * _stride);
     vkUnmapMemory(device, _bufferMemory);
 }
 
+std::future<std::vector<char>> ComputeBuffer::readAsync(uint64_t count, uint64_t srcOffset)
+{
+    if (srcOffset > _count || count > _count - srcOffset)
+    {
+        throw std::runtime_error("readback out of buffer range!");
+    }
+
+    auto promise = std::make_shared<std::promise<std::vector<char>>>();
+    std::future<std::vector<char>> future = promise->get_future();
+
+    readAsync(count, srcOffset, [promise](const void *data, size_t size)
+    {
+        try
+        {
+            const char *bytes = (const char *)data;
+            promise->set_value(std::vector<char>(bytes, bytes + size));
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+
+    return future;
+}
+
+void ComputeBuffer::readAsync(uint64_t count, uint64_t srcOffset, const std::function<void(const void *data, size_t size)> &callback)
+{
+    if (srcOffset > _count || count > _count - srcOffset)
+    {
+        throw std::runtime_error("readback out of buffer range!");
+    }
+
+    // the copy reads _buffer when the queue gets to it, so it stays resident until the fence has signalled
+    ResidencyManager::Instance().pin({this});
+
+    try
+    {
+        AsyncReadback::Instance().read(_buffer, (VkDeviceSize)srcOffset * _stride, (VkDeviceSize)count * _stride,
+                                       [this, callback](const void *data, size_t size)
+        {
+            ResidencyManager::Instance().unpin({this});
+            callback(data, size);
+        });
+    }
+    catch (...)
+    {
+        ResidencyManager::Instance().unpin({this});
+        throw;
+    }
+}
+
+uint32_t ComputeBuffer::getBindlessIndex()
+{
+    if (_bindlessIndex == UINT32_MAX)
+    {
+        // bindless buffers are never evicted again, see ResidencyManager
+        if (_evicted != nullptr)
+        {
+            ResidencyManager::Instance().use({this});
+        }
+
+        _bindlessIndex = BindlessHeap::Instance().add(this);
+    }
+
+    return _bindlessIndex;
+}
+
+void ComputeBuffer::evict()
+{
+    if (_mapped != nullptr || _externalHandleTypes != 0)
+    {
+        throw std::runtime_error("mapped, imported and shared buffers cannot be evicted!");
+    }
+
+    if (_evicted != nullptr)
+    {
+        return;
+    }
+
+    // a bindless index or a recorded descriptor would point at the destroyed VkBuffer
+    if (hasBindlessIndex() || ResidencyManager::Instance().isInUse(this))
+    {
+        throw std::runtime_error("buffer is still referenced by the bindless heap or a recording!");
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    // waits for all earlier submissions, so nothing pending still uses the buffer
+    ComputeBuffer* copy = new ComputeBuffer(_count, _stride, Readback);
+    VulkanContext::Instance().copyBuffer(_buffer, copy->getBuffer(), getSize());
+
+    vkDestroyBuffer(device, _buffer, nullptr);
+    VulkanContext::Instance().freeMemory(_bufferMemory);
+
+    _buffer = VK_NULL_HANDLE;
+    _bufferMemory = VK_NULL_HANDLE;
+    _storageBufferInfo.buffer = VK_NULL_HANDLE;
+    _evicted = copy;
+}
+
+void ComputeBuffer::makeResident()
+{
+    if (_evicted == nullptr)
+    {
+        return;
+    }
+
+    allocate();
+    VulkanContext::Instance().copyBuffer(_evicted->getBuffer(), _buffer, getSize());
+
+    _evicted->release();
+    delete _evicted;
+    _evicted = nullptr;
+}
+
 void ComputeBuffer::release()
 {
     VkDevice device = VulkanContext::Instance().device;
+
+    ResidencyManager::Instance().unmanage(this);
+
+    if (_evicted != nullptr)
+    {
+        _evicted->release();
+        delete _evicted;
+        _evicted = nullptr;
+    }
+
+    if (_bindlessIndex != UINT32_MAX)
+    {
+        BindlessHeap::Instance().remove(_bindlessIndex);
+        _bindlessIndex = UINT32_MAX;
+    }
+
+    if (_mapped != nullptr && !_imported)
+    {
+        vkUnmapMemory(device, _bufferMemory);
+    }
+
+    _mapped = nullptr;
+
     vkDestroyBuffer(device, _buffer, nullptr);
-    vkFreeMemory(device, _bufferMemory, nullptr);
-}
\ No newline at end of file
+    VulkanContext::Instance().freeMemory(_bufferMemory);
+}
+
+ComputeBuffer* ComputeBuffer::createFromFile(const std::string& filename, int stride, ComputeBufferMode usage, uint64_t offset, uint64_t length)
+{
+    if (stride <= 0)
+    {
+        throw std::runtime_error("invalid stride for buffer!");
+    }
+
+#ifdef _WIN32
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open file!");
+    }
+
+    uint64_t fileSize = (uint64_t)file.tellg();
+#else
+    FileGuard guard;
+    guard.fd = open(filename.c_str(), O_RDONLY);
+
+    if (guard.fd < 0)
+    {
+        throw std::runtime_error("failed to open file!");
+    }
+
+    struct stat st;
+
+    if (fstat(guard.fd, &st) != 0)
+    {
+        throw std::runtime_error("failed to stat file!");
+    }
+
+    uint64_t fileSize = (uint64_t)st.st_size;
+#endif
+
+    if (length == 0 && offset < fileSize)
+    {
+        length = fileSize - offset;
+    }
+
+    if (length == 0 || offset > fileSize || length > fileSize - offset || length % stride != 0)
+    {
+        throw std::runtime_error("invalid file region for buffer!");
+    }
+
+#ifdef _WIN32
+    auto readChunk = [&](void* dst, uint64_t pos, size_t size)
+    {
+        file.seekg(offset + pos);
+        file.read((char*)dst, size);
+    };
+#else
+    // mmap 的起点必须按页对齐
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t mapOffset = offset - offset % pageSize;
+    size_t mapLength = (size_t)(length + offset - mapOffset);
+
+    void* mapping = mmap(nullptr, mapLength, PROT_READ, MAP_PRIVATE, guard.fd, (off_t)mapOffset);
+
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("failed to map file!");
+    }
+
+    guard.mapping = mapping;
+    guard.length = mapLength;
+
+    madvise(mapping, mapLength, MADV_SEQUENTIAL);
+
+    const char* src = (const char*)mapping + (offset - mapOffset);
+
+    auto readChunk = [&](void* dst, uint64_t pos, size_t size)
+    {
+        uint64_t next = pos + size;
+        if (next < length)
+        {
+            uint64_t ahead = std::min<uint64_t>(FILE_CHUNK_SIZE, length - next);
+            uint64_t start = (uint64_t)(src + next - (const char*)mapping);
+            start -= start % pageSize;
+            madvise((char*)mapping + start, (size_t)std::min<uint64_t>(ahead + pageSize, mapLength - start), MADV_WILLNEED);
+        }
+
+        memcpy(dst, src + pos, size);
+
+        // 已经拷贝过的页不再需要，避免整个文件驻留在进程里
+        uint64_t end = (uint64_t)(src + pos + size - (const char*)mapping);
+        end -= end % pageSize;
+        if (end > 0)
+        {
+            madvise(mapping, (size_t)end, MADV_DONTNEED);
+        }
+    };
+#endif
+
+    ComputeBuffer* buffer = new ComputeBuffer(length / stride, stride, usage);
+    VkDevice device = VulkanContext::Instance().device;
+
+    try
+    {
+        if (usage != DeviceLocal)
+        {
+            void* data = buffer->_mapped;
+            if (data == nullptr)
+            {
+                vkMapMemory(device, buffer->_bufferMemory, 0, VK_WHOLE_SIZE, 0, &data);
+            }
+
+            for (uint64_t pos = 0; pos < length; pos += FILE_CHUNK_SIZE)
+            {
+                readChunk((char*)data + pos, pos, (size_t)std::min<uint64_t>(FILE_CHUNK_SIZE, length - pos));
+            }
+
+            if (buffer->_mapped == nullptr)
+            {
+                vkUnmapMemory(device, buffer->_bufferMemory);
+            }
+        }
+        else
+        {
+            // 分块拷进 staging 环，GPU 拷贝上一块的同时 CPU 填下一块
+            ComputeBuffer* staging[FILE_STAGING_SLOTS] = {};
+            VkCommandBuffer commandBuffers[FILE_STAGING_SLOTS] = {};
+            VkFence fences[FILE_STAGING_SLOTS] = {};
+            bool pending[FILE_STAGING_SLOTS] = {};
+
+            // waits for copies still in flight, so nothing is freed under the GPU
+            auto releaseStaging = [&]()
+            {
+                for (int i = 0; i != FILE_STAGING_SLOTS; ++i)
+                {
+                    if (pending[i])
+                    {
+                        VulkanContext::Instance().waitForFence(fences[i]);
+                    }
+
+                    if (fences[i] != VK_NULL_HANDLE)
+                    {
+                        vkDestroyFence(device, fences[i], nullptr);
+                    }
+
+                    if (commandBuffers[i] != VK_NULL_HANDLE)
+                    {
+                        VulkanContext::Instance().freeCommandBuffer(commandBuffers[i]);
+                    }
+
+                    if (staging[i] != nullptr)
+                    {
+                        staging[i]->release();
+                        delete staging[i];
+                    }
+                }
+            };
+
+            try
+            {
+                uint64_t chunkSize = std::min<uint64_t>(FILE_CHUNK_SIZE, length);
+
+                VkFenceCreateInfo fenceInfo{};
+                fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+                for (int i = 0; i != FILE_STAGING_SLOTS; ++i)
+                {
+                    staging[i] = new ComputeBuffer(chunkSize, 1, Staging);
+                    commandBuffers[i] = VulkanContext::Instance().allocateCommandBuffer();
+
+                    if (vkCreateFence(device, &fenceInfo, nullptr, &fences[i]) != VK_SUCCESS)
+                    {
+                        throw std::runtime_error("failed to create fence!");
+                    }
+                }
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+                int slot = 0;
+                for (uint64_t pos = 0; pos < length; pos += chunkSize, slot = (slot + 1) % FILE_STAGING_SLOTS)
+                {
+                    if (pending[slot])
+                    {
+                        VulkanContext::Instance().waitForFence(fences[slot]);
+                        vkResetFences(device, 1, &fences[slot]);
+                        pending[slot] = false;
+                    }
+
+                    size_t size = (size_t)std::min<uint64_t>(chunkSize, length - pos);
+                    readChunk(staging[slot]->_mapped, pos, size);
+
+                    VkBufferCopy region{};
+                    region.srcOffset = 0;
+                    region.dstOffset = pos;
+                    region.size = size;
+
+                    vkResetCommandBuffer(commandBuffers[slot], 0);
+                    vkBeginCommandBuffer(commandBuffers[slot], &beginInfo);
+                    vkCmdCopyBuffer(commandBuffers[slot], staging[slot]->_buffer, buffer->_buffer, 1, &region);
+                    vkEndCommandBuffer(commandBuffers[slot]);
+
+                    VulkanContext::Instance().submit(commandBuffers[slot], fences[slot]);
+                    pending[slot] = true;
+                }
+            }
+            catch (...)
+            {
+                releaseStaging();
+                throw;
+            }
+
+            releaseStaging();
+        }
+    }
+    catch (...)
+    {
+        buffer->release();
+        delete buffer;
+        throw;
+    }
+
+    Metrics::Instance().recordUpload((size_t)length);
+
+    return buffer;
+}
@@ -2,22 +2,53 @@
 #define __VE_COMPUTE_BUFFER_H__
 
 #include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <future>
+#include <functional>
 
 enum ComputeBufferMode
 {
     Immutable = 1,
     Dynamic,
-    SubUpdates
+    SubUpdates,
+    DeviceLocal, // GPU-only memory, filled and read back through transfer commands
+    Staging,     // host-visible upload memory, persistently mapped
+    Readback     // host-visible (cached when available) download memory, persistently mapped
 };
 
 class ComputeBuffer
 {
 public:
-    ComputeBuffer(int count, int stride, ComputeBufferMode usage = Immutable);
+    ComputeBuffer(uint64_t count, int stride, ComputeBufferMode usage = Immutable);
 
-    void setData(void *array, int count, int srcOffset = 0, int dstOffset = 0);
+    // map [offset, offset + length) of a file (length 0 = to the end) and stream it into a new buffer
+    // in large chunks, through a staging ring for DeviceLocal buffers; the file never lands on the heap
+    static ComputeBuffer* createFromFile(const std::string& filename, int stride, ComputeBufferMode usage = DeviceLocal, uint64_t offset = 0, uint64_t length = 0);
 
-    void getData(void *array, int count, int srcOffset = 0, int dstOffset = 0);
+    // wrap existing host memory without a copy (VK_EXT_external_memory_host); pointer and size must be
+    // aligned to getHostAlignment(), otherwise this falls back to a normal buffer filled with setData
+    ComputeBuffer(void *hostPointer, uint64_t count, int stride);
+
+    // memory that other processes on the same device can import, see exportFd() and FdChannel
+    static ComputeBuffer* createExportable(uint64_t count, int stride, ComputeBufferMode usage = DeviceLocal);
+
+    // import memory exported by createExportable with the same count, stride and usage, and the exporter's
+    // getMemoryTypeIndex() and getAllocationSize(); the fd is owned by the driver afterwards, and stays with the caller if this throws
+    static ComputeBuffer* importFd(int fd, uint64_t count, int stride, ComputeBufferMode usage, uint32_t memoryTypeIndex, VkDeviceSize allocationSize);
+
+    // new POSIX file descriptor for the memory of an exportable buffer, the caller closes it
+    int exportFd();
+
+    void setData(void *array, uint64_t count, uint64_t srcOffset = 0, uint64_t dstOffset = 0);
+
+    void getData(void *array, uint64_t count, uint64_t srcOffset = 0, uint64_t dstOffset = 0);
+
+    // copy count elements starting at srcOffset into host cached staging behind the submitted work,
+    // the host is never blocked; works for DeviceLocal buffers as well
+    std::future<std::vector<char>> readAsync(uint64_t count, uint64_t srcOffset = 0);
+
+    void readAsync(uint64_t count, uint64_t srcOffset, const std::function<void(const void *data, size_t size)> &callback);
 
     void release();
 
@@ -26,12 +57,110 @@ public:
         return &_storageBufferInfo;
     }
 
+    inline VkBuffer getBuffer() const
+    {
+        return _buffer;
+    }
+
+    inline VkDeviceSize getSize() const
+    {
+        return (VkDeviceSize)_count * _stride;
+    }
+
+    inline int getStride() const
+    {
+        return _stride;
+    }
+
+    inline uint64_t getCount() const
+    {
+        return _count;
+    }
+
+    inline ComputeBufferMode getUsage() const
+    {
+        return _usage;
+    }
+
+    // only valid for Staging, Readback and imported buffers
+    inline void* getMapped() const
+    {
+        return _mapped;
+    }
+
+    // false when the host memory import fell back to a copy, results then need getData
+    inline bool isImported() const
+    {
+        return _imported;
+    }
+
+    // exported or imported through a file descriptor
+    inline bool isExternal() const
+    {
+        return _externalHandleTypes != 0;
+    }
+
+    // of the device memory behind the buffer, an importer of exportFd() allocates exactly this
+    inline uint32_t getMemoryTypeIndex() const
+    {
+        return _memoryTypeIndex;
+    }
+
+    inline VkDeviceSize getAllocationSize() const
+    {
+        return _allocationSize;
+    }
+
+    // copy the contents to host memory and free the device allocation, see ResidencyManager;
+    // throws for buffers in the BindlessHeap and buffers a descriptor set or submission still references
+    void evict();
+
+    // recreate the device buffer from the host copy; the VkBuffer changes, descriptor sets captured before are stale
+    void makeResident();
+
+    inline bool isResident() const
+    {
+        return _evicted == nullptr;
+    }
+
+    // slot of this buffer in the BindlessHeap, registered on first use and freed by release()
+    uint32_t getBindlessIndex();
+
+    inline bool hasBindlessIndex() const
+    {
+        return _bindlessIndex != UINT32_MAX;
+    }
+
+    static VkDeviceSize getHostAlignment();
+
+    // host allocation suitable for the zero copy constructor, size is rounded up to the alignment
+    static void* allocateHost(size_t size);
+
+    static void freeHost(void *pointer);
+
 private:
+    ComputeBuffer(uint64_t count, int stride, ComputeBufferMode usage, VkExternalMemoryHandleTypeFlags handleTypes, int importFd,
+                  uint32_t memoryTypeIndex = 0, VkDeviceSize allocationSize = 0);
+
+    void allocate();
+
+    // false when the driver cannot import the pointer, nothing is left allocated then
+    bool importHost(void *hostPointer);
+
+    uint64_t _count;
     int _stride;
-    int _count;
+    ComputeBufferMode _usage;
+    void* _mapped = nullptr;
+    bool _imported = false;
+    uint32_t _bindlessIndex = UINT32_MAX;
+    ComputeBuffer* _evicted = nullptr;
+    uint32_t _memoryTypeIndex = 0;
+    VkDeviceSize _allocationSize = 0;
+    VkExternalMemoryHandleTypeFlags _externalHandleTypes = 0;
+    int _importFd = -1;
     VkBuffer _buffer;
     VkDeviceMemory _bufferMemory;
     VkDescriptorBufferInfo _storageBufferInfo;
 };
 
-#endif
\ No newline at end of file
+#endif
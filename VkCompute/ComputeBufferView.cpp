@@ -0,0 +1,77 @@
+#include "ComputeBufferView.h"
+#include "ComputeBuffer.h"
+#include "VulkanContext.h"
+#include <stdexcept>
+#include <numeric>
+#include <algorithm>
+
+ComputeBufferView::ComputeBufferView(ComputeBuffer *buffer) : _buffer(buffer), _first(0), _count(buffer->getCount())
+{
+}
+
+ComputeBufferView::ComputeBufferView(ComputeBuffer *buffer, uint64_t first, uint64_t count) : _buffer(buffer), _first(first), _count(count)
+{
+    if (count == 0 || first > buffer->getCount() || count > buffer->getCount() - first)
+    {
+        throw std::runtime_error("buffer view out of range!");
+    }
+}
+
+std::vector<ComputeBufferView> ComputeBufferView::split(ComputeBuffer *buffer, uint64_t maxCount, uint64_t multiple)
+{
+    const VkPhysicalDeviceLimits &limits = VulkanContext::Instance().getProperties().limits;
+
+    // elements per view: fits one binding, and every view starts on an aligned byte offset
+    uint64_t unit = getUnit(buffer, multiple);
+    uint64_t chunk = limits.maxStorageBufferRange / (uint64_t)buffer->getStride();
+
+    if (maxCount != 0)
+    {
+        chunk = std::min(chunk, maxCount);
+    }
+
+    chunk -= chunk % unit;
+
+    if (chunk == 0)
+    {
+        throw std::runtime_error("buffer elements are too large to split into bindable views!");
+    }
+
+    std::vector<ComputeBufferView> views;
+    uint64_t count = buffer->getCount();
+
+    for (uint64_t first = 0; first < count; first += chunk)
+    {
+        views.emplace_back(buffer, first, std::min(chunk, count - first));
+    }
+
+    return views;
+}
+
+uint64_t ComputeBufferView::getUnit(ComputeBuffer *buffer, uint64_t multiple)
+{
+    uint64_t alignment = VulkanContext::Instance().getProperties().limits.minStorageBufferOffsetAlignment;
+    uint64_t stride = (uint64_t)buffer->getStride();
+
+    return std::lcm(std::max<uint64_t>(alignment / std::gcd(alignment, stride), 1), std::max<uint64_t>(multiple, 1));
+}
+
+VkDeviceSize ComputeBufferView::getOffset() const
+{
+    return (VkDeviceSize)_first * _buffer->getStride();
+}
+
+VkDeviceSize ComputeBufferView::getRange() const
+{
+    return (VkDeviceSize)_count * _buffer->getStride();
+}
+
+VkDescriptorBufferInfo ComputeBufferView::getDescriptor() const
+{
+    VkDescriptorBufferInfo info{};
+    info.buffer = _buffer->getBuffer();
+    info.offset = getOffset();
+    info.range = getRange();
+
+    return info;
+}
@@ -0,0 +1,57 @@
+#ifndef __VE_COMPUTE_BUFFER_VIEW_H__
+#define __VE_COMPUTE_BUFFER_VIEW_H__
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+
+class ComputeBuffer;
+
+// Elements [first, first + count) of a ComputeBuffer, so one allocation can back several logical tensors.
+// A view owns nothing and is only valid while its buffer is; hazards are tracked on the whole buffer.
+class ComputeBufferView
+{
+public:
+    // the whole buffer
+    ComputeBufferView(ComputeBuffer *buffer);
+
+    // the byte offset must be a multiple of minStorageBufferOffsetAlignment to be bound to a shader
+    ComputeBufferView(ComputeBuffer *buffer, uint64_t first, uint64_t count);
+
+    // consecutive views covering the buffer, each small enough for maxStorageBufferRange and starting at an
+    // aligned offset; maxCount further limits the elements per view, multiple keeps every view but the last
+    // a multiple of that many elements (e.g. the workgroup size)
+    static std::vector<ComputeBufferView> split(ComputeBuffer *buffer, uint64_t maxCount = 0, uint64_t multiple = 1);
+
+    // the elements between two aligned view starts of buffer, rounded up to a multiple of multiple
+    static uint64_t getUnit(ComputeBuffer *buffer, uint64_t multiple = 1);
+
+    inline ComputeBuffer* getBuffer() const
+    {
+        return _buffer;
+    }
+
+    inline uint64_t getFirst() const
+    {
+        return _first;
+    }
+
+    inline uint64_t getCount() const
+    {
+        return _count;
+    }
+
+    VkDeviceSize getOffset() const;
+
+    VkDeviceSize getRange() const;
+
+    // descriptor for the current VkBuffer of the buffer
+    VkDescriptorBufferInfo getDescriptor() const;
+
+private:
+    ComputeBuffer *_buffer;
+    uint64_t _first;
+    uint64_t _count;
+};
+
+#endif
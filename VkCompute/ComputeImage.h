@@ -0,0 +1,74 @@
+#ifndef __VE_COMPUTE_IMAGE_H__
+#define __VE_COMPUTE_IMAGE_H__
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// 2D device local image with optimal tiling, for stencils that want the 2D cache locality of textures.
+// It stays in VK_IMAGE_LAYOUT_GENERAL so it can be bound as a storage image ("image" CSV rows) and as a
+// combined image sampler ("sampler" CSV rows) without layout transitions between dispatches.
+class ComputeImage
+{
+public:
+    // filter is used when the image is sampled, coordinates clamp to the edge
+    ComputeImage(uint32_t width, uint32_t height, VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT, VkFilter filter = VK_FILTER_LINEAR);
+
+    // whole image, tightly packed rows of width * getPixelSize() bytes, uploaded through a staging buffer
+    void setData(const void *pixels);
+
+    void getData(void *pixels);
+
+    void release();
+
+    inline const VkDescriptorImageInfo* getDescriptor() const
+    {
+        return &_imageInfo;
+    }
+
+    inline VkImage getImage() const
+    {
+        return _image;
+    }
+
+    inline uint32_t getWidth() const
+    {
+        return _width;
+    }
+
+    inline uint32_t getHeight() const
+    {
+        return _height;
+    }
+
+    inline VkFormat getFormat() const
+    {
+        return _format;
+    }
+
+    inline uint32_t getPixelSize() const
+    {
+        return _pixelSize;
+    }
+
+    inline VkDeviceSize getSize() const
+    {
+        return (VkDeviceSize)_width * _height * _pixelSize;
+    }
+
+    // bytes per pixel of the formats usable here, 0 for anything else
+    static uint32_t getFormatSize(VkFormat format);
+
+private:
+    uint32_t _width;
+    uint32_t _height;
+    VkFormat _format;
+    uint32_t _pixelSize;
+
+    VkImage _image = VK_NULL_HANDLE;
+    VkDeviceMemory _imageMemory = VK_NULL_HANDLE;
+    VkImageView _imageView = VK_NULL_HANDLE;
+    VkSampler _sampler = VK_NULL_HANDLE;
+    VkDescriptorImageInfo _imageInfo{};
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "ComputeProgram.h"
+#include "ComputeShader.h"
+#include "ComputeBuffer.h"
+#include "ComputeBufferView.h"
+#include "VulkanContext.h"
+#include "ResidencyManager.h"
+#include <stdexcept>
+
+ComputeProgram::ComputeProgram()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    _commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create program fence!");
+    }
+}
+
+void ComputeProgram::begin()
+{
+    wait();
+    freeRecording();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    vkResetCommandBuffer(_commandBuffer, 0);
+
+    if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording program command buffer!");
+    }
+
+    _recording = true;
+    _recorded = false;
+}
+
+void ComputeProgram::dispatch(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ)
+{
+    if (!_recording)
+    {
+        throw std::runtime_error("program is not recording!");
+    }
+
+    dispatch(shader, threadGroupsX, threadGroupsY, threadGroupsZ, shader->snapshotDescriptorSet(), shader->getPushConstants());
+}
+
+void ComputeProgram::dispatch(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ,
+                              VkDescriptorSet descriptorSet, const std::vector<char> &pushConstants)
+{
+    if (!_recording)
+    {
+        throw std::runtime_error("program is not recording!");
+    }
+
+    _descriptorSets.push_back(std::make_pair(shader, descriptorSet));
+
+    shader->record(_commandBuffer, threadGroupsX, threadGroupsY, threadGroupsZ, descriptorSet, pushConstants.empty() ? nullptr : pushConstants.data());
+}
+
+void ComputeProgram::copy(const ComputeBufferView &src, const ComputeBufferView &dst)
+{
+    if (!_recording)
+    {
+        throw std::runtime_error("program is not recording!");
+    }
+
+    if (src.getRange() != dst.getRange())
+    {
+        throw std::runtime_error("copy ranges differ in size!");
+    }
+
+    // vkCmdCopyBuffer leaves overlapping source and destination regions undefined
+    if (src.getBuffer() == dst.getBuffer() && src.getOffset() < dst.getOffset() + dst.getRange() && dst.getOffset() < src.getOffset() + src.getRange())
+    {
+        throw std::runtime_error("copy regions overlap!");
+    }
+
+    pinTransfer({src.getBuffer(), dst.getBuffer()});
+
+    VkBufferCopy region{};
+    region.srcOffset = src.getOffset();
+    region.dstOffset = dst.getOffset();
+    region.size = src.getRange();
+
+    vkCmdCopyBuffer(_commandBuffer, src.getBuffer()->getBuffer(), dst.getBuffer()->getBuffer(), 1, &region);
+}
+
+void ComputeProgram::fill(const ComputeBufferView &dst, uint32_t value)
+{
+    if (!_recording)
+    {
+        throw std::runtime_error("program is not recording!");
+    }
+
+    if (dst.getOffset() % 4 != 0 || dst.getRange() % 4 != 0)
+    {
+        throw std::runtime_error("fill range must be 4 byte aligned!");
+    }
+
+    pinTransfer({dst.getBuffer()});
+
+    vkCmdFillBuffer(_commandBuffer, dst.getBuffer()->getBuffer(), dst.getOffset(), dst.getRange(), value);
+}
+
+void ComputeProgram::update(const ComputeBufferView &dst, const void *data)
+{
+    if (!_recording)
+    {
+        throw std::runtime_error("program is not recording!");
+    }
+
+    if (dst.getOffset() % 4 != 0 || dst.getRange() % 4 != 0 || dst.getRange() > 65536)
+    {
+        throw std::runtime_error("update range must be 4 byte aligned and at most 65536 bytes!");
+    }
+
+    pinTransfer({dst.getBuffer()});
+
+    vkCmdUpdateBuffer(_commandBuffer, dst.getBuffer()->getBuffer(), dst.getOffset(), dst.getRange(), data);
+}
+
+void ComputeProgram::barrier()
+{
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void ComputeProgram::barrier(const std::vector<ComputeBuffer *> &buffers)
+{
+    std::vector<VkBufferMemoryBarrier> bufferBarriers(buffers.size());
+
+    for (size_t i = 0; i != buffers.size(); ++i)
+    {
+        bufferBarriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarriers[i].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarriers[i].buffer = buffers[i]->getBuffer();
+        bufferBarriers[i].offset = 0;
+        bufferBarriers[i].size = VK_WHOLE_SIZE;
+    }
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, (uint32_t)bufferBarriers.size(), bufferBarriers.data(), 0, nullptr);
+}
+
+void ComputeProgram::end()
+{
+    // results are read back by the host or by copies after the last dispatch
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record program command buffer!");
+    }
+
+    _recording = false;
+    _recorded = true;
+}
+
+void ComputeProgram::submit()
+{
+    if (!_recorded)
+    {
+        throw std::runtime_error("program has not been recorded!");
+    }
+
+    // the command buffer may still be executing its previous replay
+    wait();
+
+    VulkanContext::Instance().submit(_commandBuffer, _fence);
+
+    _pending = true;
+}
+
+void ComputeProgram::wait()
+{
+    if (!_pending)
+    {
+        return;
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    VulkanContext::Instance().waitForFence(_fence);
+    vkResetFences(device, 1, &_fence);
+
+    _pending = false;
+}
+
+void ComputeProgram::pinTransfer(const std::vector<ComputeBuffer *> &buffers)
+{
+    // the command buffer keeps the VkBuffer handles, so the buffers stay resident until the recording is discarded
+    ResidencyManager::Instance().pin(buffers);
+    _transferBuffers.insert(_transferBuffers.end(), buffers.begin(), buffers.end());
+}
+
+void ComputeProgram::freeRecording()
+{
+    for (auto &it : _descriptorSets)
+    {
+        it.first->freeDescriptorSet(it.second);
+    }
+
+    _descriptorSets.clear();
+
+    ResidencyManager::Instance().unpin(_transferBuffers);
+    _transferBuffers.clear();
+}
+
+void ComputeProgram::release()
+{
+    wait();
+    freeRecording();
+
+    vkDestroyFence(VulkanContext::Instance().device, _fence, nullptr);
+    VulkanContext::Instance().freeCommandBuffer(_commandBuffer);
+}
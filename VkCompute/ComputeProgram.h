@@ -0,0 +1,77 @@
+#ifndef __VE_COMPUTE_PROGRAM_H__
+#define __VE_COMPUTE_PROGRAM_H__
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <utility>
+
+
+class ComputeShader;
+class ComputeBuffer;
+class ComputeBufferView;
+
+// A sequence of dispatches recorded once into a reusable command buffer and replayed by submit().
+// Bindings and push constants are captured at record time; uniform values are uploaded on every
+// submit, so only uniforms may change between replays without recording again.
+class ComputeProgram
+{
+public:
+    ComputeProgram();
+
+    // start recording, a previous recording is discarded
+    void begin();
+
+    // records the shader with its current buffers and push constants
+    void dispatch(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    // records with a descriptor set and push constants captured earlier, the program takes ownership of the set
+    // unless it is not recording
+    void dispatch(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ,
+                  VkDescriptorSet descriptorSet, const std::vector<char> &pushConstants);
+
+    // transfer commands on the device, ranges must have the same size and must not overlap; a ComputeBuffer* converts to its whole range
+    void copy(const ComputeBufferView &src, const ComputeBufferView &dst);
+
+    // every 32-bit word of the range set to value, the range must be a multiple of 4 bytes
+    void fill(const ComputeBufferView &dst, uint32_t value);
+
+    // data is copied into the command buffer now, every replay writes the same bytes; at most 65536 bytes
+    void update(const ComputeBufferView &dst, const void *data);
+
+    // makes shader and transfer writes of earlier commands visible to later ones
+    void barrier();
+
+    // only the given buffers are made visible; an empty list orders execution without any memory dependency
+    void barrier(const std::vector<ComputeBuffer *> &buffers);
+
+    void end();
+
+    // waits for the previous replay, uploads uniforms and submits without blocking
+    void submit();
+
+    void wait();
+
+    inline void run()
+    {
+        submit();
+        wait();
+    }
+
+    void release();
+
+private:
+    VkCommandBuffer _commandBuffer;
+    VkFence _fence;
+    bool _recording = false;
+    bool _recorded = false;
+    bool _pending = false;
+    std::vector<std::pair<ComputeShader *, VkDescriptorSet>> _descriptorSets;
+    std::vector<ComputeBuffer *> _transferBuffers;
+
+    void pinTransfer(const std::vector<ComputeBuffer *> &buffers);
+
+    // frees the descriptor sets and unpins the buffers of the last recording
+    void freeRecording();
+};
+
+#endif
@@ -1,14 +1,22 @@
 #include "ComputeShader.h"
 #include "VulkanContext.h"
 #include "ComputeBuffer.h"
+#include "ComputeImage.h"
+#include "ComputeBufferView.h"
 #include <iostream>
 #include <fstream>
 #include <array>
+#include <cstring>
+#include <algorithm>
 #include "UniformData.h"
 #include "BindingsTable.h"
+#include "BindlessHeap.h"
+#include "ResidencyManager.h"
 
+// sets per descriptor pool, another pool is created when all of them are in use
+#define MAX_DESCRIPTOR_SETS 16
 
-ComputeShader::ComputeShader(const std::string &filename, const std::string& kernel)
+ComputeShader::ComputeShader(const std::string &filename, const std::string& kernel, bool deferred) : _kernel(kernel)
 {
     VkDevice device = VulkanContext::Instance().device;
 
@@ -21,15 +29,13 @@ ComputeShader::ComputeShader(const std::string &filename, const std::string& ker
     }
 
     size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    _code.resize(fileSize);
 
     file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    file.read(_code.data(), fileSize);
 
     file.close();
 
-    VkShaderModule computeShaderModule = createShaderModule(buffer);
-
     // create VkDescriptorSetLayout
     BindingsTable bindings(filename);
 
@@ -38,84 +44,276 @@ ComputeShader::ComputeShader(const std::string &filename, const std::string& ker
 
     for (int i = 0; i != bindings.size(); ++i)
     {
-        VkDescriptorType descType = bindings.getType(i) == "uniform" ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        addBinding(bindings.getName(i), descType);
+        // "push" rows declare the push constant block size and take no binding slot
+        if (bindings.getType(i) == "push")
+        {
+            _pushConstants.resize((size_t)bindings.getValue(i));
+            continue;
+        }
+
+        // "bindless" rows add the BindlessHeap as set 1
+        if (bindings.getType(i) == "bindless")
+        {
+            if (!BindlessHeap::Instance().isAvailable())
+            {
+                throw std::runtime_error("bindless shaders need VK_EXT_descriptor_indexing!");
+            }
+
+            _bindless = true;
+            continue;
+        }
+
+        VkDescriptorType descType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        if (bindings.getType(i) == "uniform")
+        {
+            descType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+        else if (bindings.getType(i) == "image")
+        {
+            descType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        }
+        else if (bindings.getType(i) == "sampler")
+        {
+            descType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        }
+
+        addBinding(bindings.getName(i), descType, bindings.getValueString(i));
+
+        // the value column of a buffer row is the element stride the shader expects
+        _declaredStrides.push_back(descType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ? (int)bindings.getValue(i) : 0);
+
+        std::string access = bindings.getAccess(i);
+        _accesses.push_back(access == "readonly" ? ReadOnly : access == "writeonly" ? WriteOnly : ReadWrite);
+    }
+
+    _boundBuffers.resize(_bindings.size(), nullptr);
+    _viewDescriptors.resize(_bindings.size());
+
+    // a failure past this point destroys the layouts and pools created so far
+    try
+    {
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = (uint32_t)_bindings.size();
+        layoutInfo.pBindings = _bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute descriptor set layout!");
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        VkDescriptorSetLayout setLayouts[] = {_descriptorSetLayout, BindlessHeap::Instance().getLayout()};
+
+        pipelineLayoutInfo.setLayoutCount = _bindless ? 2 : 1;
+        pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = (uint32_t)_pushConstants.size();
+
+        if (!_pushConstants.empty())
+        {
+            pipelineLayoutInfo.pushConstantRangeCount = 1;
+            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        }
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &_computePipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create compute pipeline layout!");
+        }
+
+        createDescriptorSet();
+
+        if (!deferred)
+        {
+            compile();
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
     }
+}
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = (uint32_t)_bindings.size();
-    layoutInfo.pBindings = _bindings.data();
+void ComputeShader::compile()
+{
+    std::lock_guard<std::mutex> lock(_compileMutex);
 
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create compute descriptor set layout!");
+    if (_computePipeline != VK_NULL_HANDLE)
+    {
+        return;
     }
 
+    VkDevice device = VulkanContext::Instance().device;
+
+    VkShaderModule computeShaderModule = createShaderModule(_code);
+
     VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
     computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
     computeShaderStageInfo.module = computeShaderModule;
-    computeShaderStageInfo.pName = kernel.c_str();
+    computeShaderStageInfo.pName = _kernel.c_str();
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+    std::vector<VkSpecializationMapEntry> mapEntries;
+    std::vector<uint32_t> specializationData;
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &_computePipelineLayout) != VK_SUCCESS)
+    for (const auto &it : _specialization)
     {
-        throw std::runtime_error("failed to create compute pipeline layout!");
+        VkSpecializationMapEntry entry{};
+        entry.constantID = it.first;
+        entry.offset = (uint32_t)(specializationData.size() * sizeof(uint32_t));
+        entry.size = sizeof(uint32_t);
+
+        mapEntries.push_back(entry);
+        specializationData.push_back(it.second);
+    }
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = (uint32_t)mapEntries.size();
+    specializationInfo.pMapEntries = mapEntries.data();
+    specializationInfo.dataSize = specializationData.size() * sizeof(uint32_t);
+    specializationInfo.pData = specializationData.data();
+
+    if (!mapEntries.empty())
+    {
+        computeShaderStageInfo.pSpecializationInfo = &specializationInfo;
     }
 
     VkComputePipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    // record() splits grids past maxComputeWorkGroupCount into vkCmdDispatchBase calls
+    pipelineInfo.flags = VK_PIPELINE_CREATE_DISPATCH_BASE_BIT;
     pipelineInfo.layout = _computePipelineLayout;
     pipelineInfo.stage = computeShaderStageInfo;
 
-    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_computePipeline) != VK_SUCCESS)
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, VulkanContext::Instance().getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create compute pipeline!");
     }
 
-    vkDestroyShaderModule(device, computeShaderModule, nullptr);
-
-    createDescriptorSet();
+    _code.clear();
+    _code.shrink_to_fit();
+    _computePipeline = pipeline;
+    _compiled = true;
 }
 
-void ComputeShader::createDescriptorSet()
+VkDescriptorPool ComputeShader::createDescriptorPool()
 {
-    VkDevice device = VulkanContext::Instance().device;
+    std::vector<VkDescriptorPoolSize> poolDataTypes;
+
+    if (_uniformBindingsCount > 0)
+    {
+        poolDataTypes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (uint32_t)_uniformBindingsCount * MAX_DESCRIPTOR_SETS});
+    }
+
+    if (_storageBingingsCount > 0)
+    {
+        poolDataTypes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)_storageBingingsCount * MAX_DESCRIPTOR_SETS});
+    }
 
-    std::array<VkDescriptorPoolSize, 2> poolDataTypes{};
-    poolDataTypes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolDataTypes[0].descriptorCount = _uniformBindingsCount;
-    poolDataTypes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolDataTypes[1].descriptorCount = _storageBingingsCount;
+    if (_imageBindingsCount > 0)
+    {
+        poolDataTypes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, (uint32_t)_imageBindingsCount * MAX_DESCRIPTOR_SETS});
+    }
+
+    if (_samplerBindingsCount > 0)
+    {
+        poolDataTypes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (uint32_t)_samplerBindingsCount * MAX_DESCRIPTOR_SETS});
+    }
+
+    // bindless shaders may have nothing in set 0, a pool still needs one size
+    if (poolDataTypes.empty())
+    {
+        poolDataTypes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1});
+    }
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = (uint32_t)poolDataTypes.size();
     poolInfo.pPoolSizes = poolDataTypes.data();
-    poolInfo.maxSets = 1;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = MAX_DESCRIPTOR_SETS;
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &_descriptorPool) != VK_SUCCESS)
+    VkDescriptorPool pool;
+
+    if (vkCreateDescriptorPool(VulkanContext::Instance().device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create descriptor pool!");
     }
 
+    _descriptorPools.push_back(pool);
+
+    return pool;
+}
+
+VkDescriptorSet ComputeShader::allocateSet()
+{
+    std::lock_guard<std::mutex> lock(_poolMutex);
+
     VkDescriptorSetAllocateInfo allocateInfo = {};
     allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocateInfo.descriptorPool = _descriptorPool;
     allocateInfo.descriptorSetCount = 1;
     allocateInfo.pSetLayouts = &_descriptorSetLayout;
 
-    if (vkAllocateDescriptorSets(device, &allocateInfo, &_descriptorSet) != VK_SUCCESS)
+    VkDescriptorSet descriptorSet;
+
+    // newest pool first, it is the one most likely to have room
+    for (auto it = _descriptorPools.rbegin(); it != _descriptorPools.rend(); ++it)
+    {
+        allocateInfo.descriptorPool = *it;
+
+        if (vkAllocateDescriptorSets(VulkanContext::Instance().device, &allocateInfo, &descriptorSet) == VK_SUCCESS)
+        {
+            _descriptorSetPools[descriptorSet] = *it;
+            return descriptorSet;
+        }
+    }
+
+    // every pool is full, recordings keep their sets until released so grow instead of failing
+    allocateInfo.descriptorPool = createDescriptorPool();
+
+    if (vkAllocateDescriptorSets(VulkanContext::Instance().device, &allocateInfo, &descriptorSet) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
-    uint32_t count = _uniformBindingsCount + _storageBingingsCount;
+    _descriptorSetPools[descriptorSet] = allocateInfo.descriptorPool;
+
+    return descriptorSet;
+}
+
+void ComputeShader::createDescriptorSet()
+{
+    _descriptorSet = allocateSet();
+
+    uint32_t count = _uniformBindingsCount + _storageBingingsCount + _imageBindingsCount + _samplerBindingsCount;
     _descriptorWrites.resize(count);
+
+    // uniform blocks never move, bind them up front so CSV defaults work without setUniform
+    for (const auto &it : _bindingsMap)
+    {
+        int i = it.second;
+
+        if (_bindings[i].descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        {
+            _descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            _descriptorWrites[i].dstSet = _descriptorSet;
+            _descriptorWrites[i].dstBinding = i;
+            _descriptorWrites[i].dstArrayElement = 0;
+            _descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            _descriptorWrites[i].descriptorCount = 1;
+            _descriptorWrites[i].pBufferInfo = UniformData::Instance().getDescriptorBufferInfo(it.first);
+        }
+    }
 }
 
 VkShaderModule ComputeShader::createShaderModule(const std::vector<char> &code)
@@ -136,9 +334,34 @@ VkShaderModule ComputeShader::createShaderModule(const std::vector<char> &code)
     return shaderModule;
 }
 
-void ComputeShader::dispatch(int threadGroupsX, int threadGroupsY, int threadGroupsZ)
+void ComputeShader::setSpecialization(uint32_t id, uint32_t value)
+{
+    std::lock_guard<std::mutex> lock(_compileMutex);
+
+    if (_computePipeline != VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("failed to set specialization, pipeline already compiled!");
+    }
+
+    _specialization[id] = value;
+}
+
+void ComputeShader::dispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ)
 {
     VkDevice device = VulkanContext::Instance().device;
+
+    // page in evicted buffers, the writes point at their descriptors so they pick up the new VkBuffer;
+    // they stay pinned until compute() has submitted this recording and it has finished
+    ResidencyManager::Instance().use(_boundBuffers, true);
+
+    for (size_t i = 0; i != _viewDescriptors.size(); ++i)
+    {
+        if (_descriptorWrites[i].pBufferInfo == &_viewDescriptors[i])
+        {
+            _viewDescriptors[i].buffer = _boundBuffers[i]->getBuffer();
+        }
+    }
+
     vkUpdateDescriptorSets(device, (uint32_t)_descriptorWrites.size(), _descriptorWrites.data(), 0, nullptr);
 
     VkCommandBufferBeginInfo beginInfo{};
@@ -150,19 +373,187 @@ void ComputeShader::dispatch(int threadGroupsX, int threadGroupsY, int threadGro
         throw std::runtime_error("failed to begin recording compute command buffer!");
     }
 
+    record(cmd, threadGroupsX, threadGroupsY, threadGroupsZ);
+
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record compute command buffer!");
+    }
+}
+
+void ComputeShader::record(VkCommandBuffer cmd, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ, VkDescriptorSet descriptorSet, const void *pushConstants)
+{
+    bind(cmd, descriptorSet, pushConstants);
+
+    const uint32_t *maxGroups = VulkanContext::Instance().getProperties().limits.maxComputeWorkGroupCount;
+
+    if (threadGroupsX <= maxGroups[0] && threadGroupsY <= maxGroups[1] && threadGroupsZ <= maxGroups[2])
+    {
+        vkCmdDispatch(cmd, threadGroupsX, threadGroupsY, threadGroupsZ);
+        return;
+    }
+
+    // gl_WorkGroupID and gl_GlobalInvocationID include the base group, kernels see one grid
+    for (uint32_t z = 0; z < threadGroupsZ; z += std::min(maxGroups[2], threadGroupsZ - z))
+    {
+        for (uint32_t y = 0; y < threadGroupsY; y += std::min(maxGroups[1], threadGroupsY - y))
+        {
+            for (uint32_t x = 0; x < threadGroupsX; x += std::min(maxGroups[0], threadGroupsX - x))
+            {
+                vkCmdDispatchBase(cmd, x, y, z,
+                                  std::min(maxGroups[0], threadGroupsX - x),
+                                  std::min(maxGroups[1], threadGroupsY - y),
+                                  std::min(maxGroups[2], threadGroupsZ - z));
+            }
+        }
+    }
+}
+
+void ComputeShader::dispatchChunked(const std::vector<std::pair<std::string, ComputeBuffer*>>& buffers, uint64_t count, uint32_t localSizeX, uint64_t maxChunk)
+{
+    if (buffers.empty() || count == 0 || localSizeX == 0)
+    {
+        throw std::runtime_error("failed to dispatch chunks, nothing to run!");
+    }
+
+    // every chunk is made of whole workgroups, a partial last group would read and write past the views
+    if (count % localSizeX != 0)
+    {
+        throw std::runtime_error("chunked dispatch count must be a multiple of the workgroup size!");
+    }
+
+    // chunks start on an aligned offset in every buffer and fit one binding of each,
+    // so chunk i covers the same elements in all of them
+    uint64_t unit = localSizeX;
+    uint64_t chunk = maxChunk != 0 ? maxChunk : (uint64_t)UINT32_MAX * localSizeX;
+
+    for (const auto &it : buffers)
+    {
+        if (it.second->getCount() < count)
+        {
+            throw std::runtime_error("buffer is shorter than the chunked dispatch: " + it.first);
+        }
+
+        unit = ComputeBufferView::getUnit(it.second, unit);
+        chunk = std::min(chunk, (uint64_t)VulkanContext::Instance().getProperties().limits.maxStorageBufferRange / (uint64_t)it.second->getStride());
+    }
+
+    chunk -= chunk % unit;
+
+    if (chunk == 0)
+    {
+        throw std::runtime_error("failed to dispatch chunks, no aligned chunk fits one binding!");
+    }
+
+    for (uint64_t first = 0; first < count; first += chunk)
+    {
+        uint64_t elements = std::min(chunk, count - first);
+
+        for (const auto &it : buffers)
+        {
+            setBuffer(it.first, ComputeBufferView(it.second, first, elements));
+        }
+
+        dispatch((uint32_t)(elements / localSizeX), 1, 1);
+        VulkanContext::Instance().compute();
+    }
+}
+
+void ComputeShader::recordIndirect(VkCommandBuffer cmd, VkBuffer arguments, VkDeviceSize offset, VkDescriptorSet descriptorSet, const void *pushConstants)
+{
+    bind(cmd, descriptorSet, pushConstants);
+
+    vkCmdDispatchIndirect(cmd, arguments, offset);
+}
+
+void ComputeShader::bind(VkCommandBuffer cmd, VkDescriptorSet descriptorSet, const void *pushConstants)
+{
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        descriptorSet = _descriptorSet;
+    }
+
+    // deferred shaders are compiled on first use
+    if (!_compiled)
+    {
+        compile();
+    }
+
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline);
 
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    if (_bindless)
+    {
+        VkDescriptorSet heap = BindlessHeap::Instance().getDescriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipelineLayout, 1, 1, &heap, 0, nullptr);
+    }
+
+    if (!_pushConstants.empty())
+    {
+        vkCmdPushConstants(cmd, _computePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, (uint32_t)_pushConstants.size(),
+                           pushConstants != nullptr ? pushConstants : _pushConstants.data());
+    }
+}
 
-    vkCmdDispatch(cmd, threadGroupsX, threadGroupsY, threadGroupsZ);
+VkDescriptorSet ComputeShader::allocateDescriptorSet(const std::map<std::string, ComputeBuffer*>& buffers)
+{
+    VkDevice device = VulkanContext::Instance().device;
 
-    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    VkDescriptorSet descriptorSet = allocateSet();
+
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<ComputeBuffer*> referenced;
+
+    for (const auto &it : _bindingsMap)
     {
-        throw std::runtime_error("failed to record compute command buffer!");
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet;
+        write.dstBinding = it.second;
+        write.dstArrayElement = 0;
+        write.descriptorType = _bindings[it.second].descriptorType;
+        write.descriptorCount = 1;
+
+        if (write.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+        {
+            write.pBufferInfo = UniformData::Instance().getDescriptorBufferInfo(it.first);
+        }
+        else if (write.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || write.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+        {
+            // images are not part of the map, they keep what setImage bound
+            if (_descriptorWrites[it.second].pImageInfo == nullptr)
+            {
+                throw std::runtime_error("missing image for descriptor set: " + it.first);
+            }
+
+            write.pImageInfo = _descriptorWrites[it.second].pImageInfo;
+        }
+        else
+        {
+            auto buffer = buffers.find(it.first);
+
+            if (buffer == buffers.end())
+            {
+                throw std::runtime_error("missing buffer for descriptor set: " + it.first);
+            }
+
+            checkStride(it.second, it.first, buffer->second);
+            write.pBufferInfo = buffer->second->getDescriptor();
+            referenced.push_back(buffer->second);
+        }
+
+        writes.push_back(write);
     }
+
+    pinDescriptorSet(descriptorSet, referenced);
+
+    vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+    return descriptorSet;
 }
 
-void ComputeShader::addBinding(const std::string &name, VkDescriptorType descriptorType)
+void ComputeShader::addBinding(const std::string &name, VkDescriptorType descriptorType, const std::string &value)
 {
     uint32_t i = (uint32_t)_bindings.size();
 
@@ -180,15 +571,33 @@ void ComputeShader::addBinding(const std::string &name, VkDescriptorType descrip
     if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
     {
         _uniformBindingsCount++;
-        UniformData::Instance().addUniform(name);
+        UniformData::Instance().addUniform(name, value);
     }
     else if (binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
     {
         _storageBingingsCount++;
     }
+    else if (binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+    {
+        _imageBindingsCount++;
+    }
+    else
+    {
+        _samplerBindingsCount++;
+    }
 }
 
 void ComputeShader::setBuffer(const std::string &name, ComputeBuffer *buffer)
+{
+    if (buffer->getSize() > VulkanContext::Instance().getProperties().limits.maxStorageBufferRange)
+    {
+        throw std::runtime_error("buffer is larger than maxStorageBufferRange, bind views from ComputeBufferView::split: " + name);
+    }
+
+    bindBuffer(name, buffer);
+}
+
+void ComputeShader::bindBuffer(const std::string &name, ComputeBuffer *buffer)
 {
     auto it = _bindingsMap.find(name);
 
@@ -199,6 +608,8 @@ void ComputeShader::setBuffer(const std::string &name, ComputeBuffer *buffer)
 
     int i = it->second;
 
+    checkStride(i, name, buffer);
+
     _descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     _descriptorWrites[i].dstSet = _descriptorSet;
     _descriptorWrites[i].dstBinding = i;
@@ -206,37 +617,211 @@ void ComputeShader::setBuffer(const std::string &name, ComputeBuffer *buffer)
     _descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     _descriptorWrites[i].descriptorCount = 1;
     _descriptorWrites[i].pBufferInfo = buffer->getDescriptor();
+
+    _boundBuffers[i] = buffer;
 }
 
-void ComputeShader::setUniform(const std::string &name, float data)
+void ComputeShader::setBuffer(const std::string &name, const ComputeBufferView &view)
+{
+    VkDeviceSize alignment = VulkanContext::Instance().getProperties().limits.minStorageBufferOffsetAlignment;
+
+    if (view.getOffset() % alignment != 0)
+    {
+        throw std::runtime_error("buffer view offset is not aligned to minStorageBufferOffsetAlignment!");
+    }
+
+    if (view.getRange() > VulkanContext::Instance().getProperties().limits.maxStorageBufferRange)
+    {
+        throw std::runtime_error("buffer view is larger than maxStorageBufferRange: " + name);
+    }
+
+    bindBuffer(name, view.getBuffer());
+
+    int i = _bindingsMap[name];
+    _viewDescriptors[i] = view.getDescriptor();
+    _descriptorWrites[i].pBufferInfo = &_viewDescriptors[i];
+}
+
+void ComputeShader::setImage(const std::string &name, ComputeImage *image)
 {
     auto it = _bindingsMap.find(name);
 
     if (it == _bindingsMap.end())
     {
-        throw std::runtime_error("failed to set buffer!");
+        throw std::runtime_error("failed to set image!");
     }
 
-    Vector4 vec4 = {data, 0.f, 0.f, 0.f};
-    UniformData::Instance().setUniform(name, vec4);
-
     int i = it->second;
+    VkDescriptorType descriptorType = _bindings[i].descriptorType;
+
+    if (descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+    {
+        throw std::runtime_error("binding is not an image: " + name);
+    }
 
     _descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     _descriptorWrites[i].dstSet = _descriptorSet;
     _descriptorWrites[i].dstBinding = i;
     _descriptorWrites[i].dstArrayElement = 0;
-    _descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    _descriptorWrites[i].descriptorType = descriptorType;
     _descriptorWrites[i].descriptorCount = 1;
-    _descriptorWrites[i].pBufferInfo = UniformData::Instance().getDescriptorBufferInfo();
+    _descriptorWrites[i].pImageInfo = image->getDescriptor();
+}
+
+std::vector<std::pair<ComputeBuffer*, BufferAccess>> ComputeShader::getBufferAccesses() const
+{
+    std::vector<std::pair<ComputeBuffer*, BufferAccess>> result;
+
+    for (size_t i = 0; i != _boundBuffers.size(); ++i)
+    {
+        if (_boundBuffers[i] != nullptr)
+        {
+            result.push_back(std::make_pair(_boundBuffers[i], _accesses[i]));
+        }
+    }
+
+    return result;
+}
+
+VkDescriptorSet ComputeShader::snapshotDescriptorSet()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    VkDescriptorSet descriptorSet = allocateSet();
+
+    std::vector<VkWriteDescriptorSet> writes;
+
+    for (const auto &write : _descriptorWrites)
+    {
+        if (write.sType != VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET)
+        {
+            throw std::runtime_error("all buffers must be set before recording!");
+        }
+
+        writes.push_back(write);
+        writes.back().dstSet = descriptorSet;
+    }
+
+    std::vector<ComputeBuffer*> referenced;
+
+    for (ComputeBuffer *buffer : _boundBuffers)
+    {
+        if (buffer != nullptr)
+        {
+            referenced.push_back(buffer);
+        }
+    }
+
+    pinDescriptorSet(descriptorSet, referenced);
+
+    // pinning may have paged a buffer back in under a new VkBuffer
+    for (size_t i = 0; i != _viewDescriptors.size(); ++i)
+    {
+        if (writes[i].pBufferInfo == &_viewDescriptors[i])
+        {
+            _viewDescriptors[i].buffer = _boundBuffers[i]->getBuffer();
+        }
+    }
+
+    vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+    return descriptorSet;
+}
+
+void ComputeShader::freeDescriptorSet(VkDescriptorSet descriptorSet)
+{
+    std::lock_guard<std::mutex> lock(_poolMutex);
+
+    auto it = _descriptorSetPools.find(descriptorSet);
+
+    if (it == _descriptorSetPools.end())
+    {
+        throw std::runtime_error("descriptor set does not belong to this shader!");
+    }
+
+    vkFreeDescriptorSets(VulkanContext::Instance().device, it->second, 1, &descriptorSet);
+    _descriptorSetPools.erase(it);
+
+    auto buffers = _descriptorSetBuffers.find(descriptorSet);
+
+    if (buffers != _descriptorSetBuffers.end())
+    {
+        ResidencyManager::Instance().unpin(buffers->second);
+        _descriptorSetBuffers.erase(buffers);
+    }
+}
+
+void ComputeShader::pinDescriptorSet(VkDescriptorSet descriptorSet, const std::vector<ComputeBuffer*> &buffers)
+{
+    // the set captures the VkBuffer handles, they must stay resident until it is freed
+    ResidencyManager::Instance().pin(buffers);
+
+    std::lock_guard<std::mutex> lock(_poolMutex);
+    _descriptorSetBuffers[descriptorSet] = buffers;
+}
+
+void ComputeShader::setPushConstants(const void *data, size_t size)
+{
+    if (size != _pushConstants.size())
+    {
+        throw std::runtime_error("push constant size mismatch!");
+    }
+
+    memcpy(_pushConstants.data(), data, size);
+}
+
+void ComputeShader::checkStride(int binding, const std::string &name, ComputeBuffer *buffer)
+{
+    int stride = _declaredStrides[binding];
+
+    if (stride > 0 && stride != buffer->getStride())
+    {
+        throw std::runtime_error("stride mismatch for " + name + ": shader expects " + std::to_string(stride) +
+                                 " bytes, buffer has " + std::to_string(buffer->getStride()));
+    }
+}
+
+void ComputeShader::setUniform(const std::string &name, float data)
+{
+    auto it = _bindingsMap.find(name);
+
+    if (it == _bindingsMap.end())
+    {
+        throw std::runtime_error("failed to set buffer!");
+    }
+
+    Vector4 vec4 = {data, 0.f, 0.f, 0.f};
+    UniformData::Instance().setUniform(name, vec4);
 }
 
 void ComputeShader::release()
 {
     VkDevice device = VulkanContext::Instance().device;
 
-    vkDestroyPipeline(device, _computePipeline, nullptr);
+    if (_computePipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(device, _computePipeline, nullptr);
+        _computePipeline = VK_NULL_HANDLE;
+        _compiled = false;
+    }
+
     vkDestroyPipelineLayout(device, _computePipelineLayout, nullptr);
     vkDestroyDescriptorSetLayout(device, _descriptorSetLayout, nullptr);
-    vkDestroyDescriptorPool(device, _descriptorPool, nullptr);
+    _computePipelineLayout = VK_NULL_HANDLE;
+    _descriptorSetLayout = VK_NULL_HANDLE;
+
+    for (auto pool : _descriptorPools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+
+    _descriptorPools.clear();
+    _descriptorSetPools.clear();
+
+    for (const auto &it : _descriptorSetBuffers)
+    {
+        ResidencyManager::Instance().unpin(it.second);
+    }
+
+    _descriptorSetBuffers.clear();
 }
@@ -6,44 +6,161 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include "UniformData.h"
 
 
 class ComputeBuffer;
+class ComputeImage;
+class ComputeBufferView;
+
+enum BufferAccess
+{
+    ReadWrite = 0,
+    ReadOnly,
+    WriteOnly
+};
 
 class ComputeShader
 {
 public:
-    ComputeShader(const std::string& filename, const std::string& kernel="main");
+    // deferred only loads the SPIR-V and bindings, the pipeline is created by compile() or the first dispatch
+    ComputeShader(const std::string& filename, const std::string& kernel="main", bool deferred=false);
+
+    // create the pipeline if it does not exist yet, safe to call from any thread
+    void compile();
+
+    inline bool isCompiled() const
+    {
+        return _compiled;
+    }
+
+    // 32-bit specialization constant applied by compile(), only possible before the pipeline exists
+    void setSpecialization(uint32_t id, uint32_t value);
+
+    inline const std::map<uint32_t, uint32_t>& getSpecialization() const
+    {
+        return _specialization;
+    }
 
     void setBuffer(const std::string& name, ComputeBuffer* buffer);
 
+    // bind a sub-range, the view's offset must meet minStorageBufferOffsetAlignment
+    void setBuffer(const std::string& name, const ComputeBufferView& view);
+
+    // "image" rows bind it as a storage image, "sampler" rows as a combined image sampler
+    void setImage(const std::string& name, ComputeImage* image);
+
+    // storage buffers bound by setBuffer with the access declared in the CSV
+    std::vector<std::pair<ComputeBuffer*, BufferAccess>> getBufferAccesses() const;
+
     void setUniform(const std::string& name, float);
 
-    void dispatch(int threadGroupsX, int threadGroupsY, int threadGroupsZ);
+    // typed write of one std140 field of a uniform block declared in the CSV
+    template <typename T>
+    void setUniform(const std::string& name, const std::string& field, const T& value, uint32_t index = 0)
+    {
+        if (_bindingsMap.find(name) == _bindingsMap.end())
+        {
+            throw std::runtime_error("failed to set uniform!");
+        }
+
+        UniformData::Instance().set(name, field, value, index);
+    }
+
+    // size must match the "push" row of the CSV; recorded by the next dispatch or record
+    void setPushConstants(const void *data, size_t size);
+
+    template <typename T>
+    void setPushConstants(const T& value)
+    {
+        setPushConstants(&value, sizeof(T));
+    }
+
+    inline const std::vector<char>& getPushConstants() const
+    {
+        return _pushConstants;
+    }
+
+    void dispatch(uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    // bind and dispatch into a command buffer recorded by the caller, set defaults to the shader's own descriptor set
+    // and push constants to the ones last given to setPushConstants; group counts past maxComputeWorkGroupCount
+    // are split into several dispatches with a base group
+    void record(VkCommandBuffer cmd, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ, VkDescriptorSet descriptorSet = VK_NULL_HANDLE, const void *pushConstants = nullptr);
+
+    // run a 1D kernel over count elements of buffers too large for one binding: each chunk binds views of the same
+    // elements of every buffer and is submitted and waited for; gl_GlobalInvocationID.x restarts at 0 per chunk,
+    // and the last chunk's views stay bound. count must be a multiple of localSizeX so no invocation runs past
+    // its views; maxChunk further limits the elements per chunk
+    void dispatchChunked(const std::vector<std::pair<std::string, ComputeBuffer*>>& buffers, uint64_t count, uint32_t localSizeX, uint64_t maxChunk = 0);
+
+    // like record, with the group counts read from a VkDispatchIndirectCommand at offset of arguments when the GPU runs it;
+    // they are not split, whoever writes them keeps each within maxComputeWorkGroupCount
+    void recordIndirect(VkCommandBuffer cmd, VkBuffer arguments, VkDeviceSize offset, VkDescriptorSet descriptorSet = VK_NULL_HANDLE, const void *pushConstants = nullptr);
+
+    // extra descriptor set with its own storage buffers, for executors keeping several bindings in flight
+    VkDescriptorSet allocateDescriptorSet(const std::map<std::string, ComputeBuffer*>& buffers);
+
+    // copy of the currently set bindings, so a recording keeps them after later setBuffer calls;
+    // sets come from a list of pools that grows when all of them are in use
+    VkDescriptorSet snapshotDescriptorSet();
+
+    void freeDescriptorSet(VkDescriptorSet descriptorSet);
 
     void release();
 
 private:
     int _uniformBindingsCount;
     int _storageBingingsCount;
-
-    VkPipelineLayout _computePipelineLayout;
-    VkPipeline _computePipeline;
-
-    VkDescriptorSetLayout _descriptorSetLayout;
-    VkDescriptorPool _descriptorPool;
+    int _imageBindingsCount = 0;
+    int _samplerBindingsCount = 0;
+
+    std::string _kernel;
+    std::vector<char> _code;
+    std::mutex _compileMutex;
+    std::atomic<bool> _compiled{false};
+    std::map<uint32_t, uint32_t> _specialization;
+
+    VkPipelineLayout _computePipelineLayout = VK_NULL_HANDLE;
+    VkPipeline _computePipeline = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> _descriptorPools;
+    std::map<VkDescriptorSet, VkDescriptorPool> _descriptorSetPools;
+    std::map<VkDescriptorSet, std::vector<ComputeBuffer*>> _descriptorSetBuffers;
+    std::mutex _poolMutex;
     VkDescriptorSet _descriptorSet;
 
     std::vector<VkDescriptorSetLayoutBinding> _bindings;
     std::vector<VkWriteDescriptorSet> _descriptorWrites;
 
     std::map<std::string, int> _bindingsMap;
+    std::vector<int> _declaredStrides;
+    std::vector<BufferAccess> _accesses;
+    std::vector<ComputeBuffer*> _boundBuffers;
+    std::vector<VkDescriptorBufferInfo> _viewDescriptors;
+    std::vector<char> _pushConstants;
+    bool _bindless = false;
 
     VkShaderModule createShaderModule(const std::vector<char> &code);
 
-    void addBinding(const std::string& name, VkDescriptorType descriptorType);
+    void addBinding(const std::string& name, VkDescriptorType descriptorType, const std::string& value);
+
+    VkDescriptorPool createDescriptorPool();
+
+    VkDescriptorSet allocateSet();
+
+    void pinDescriptorSet(VkDescriptorSet descriptorSet, const std::vector<ComputeBuffer*> &buffers);
 
     void createDescriptorSet();
+
+    void bindBuffer(const std::string& name, ComputeBuffer* buffer);
+
+    void bind(VkCommandBuffer cmd, VkDescriptorSet descriptorSet, const void *pushConstants);
+
+    void checkStride(int binding, const std::string &name, ComputeBuffer *buffer);
 };
 
 #endif
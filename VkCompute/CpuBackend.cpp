@@ -0,0 +1,136 @@
+#include "CpuBackend.h"
+#include <vector>
+#include <future>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#if defined(__GNUC__)
+// compiled for AVX2 regardless of -march, only called after the runtime check
+#define CPU_BACKEND_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define CPU_BACKEND_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CPU_BACKEND_NEON
+#endif
+
+// below this many floats per worker the pool costs more than it saves
+#define MIN_PARALLEL_CHUNK (64 * 1024)
+
+static void addScalarScalar(const float *in, float *out, size_t count, float value)
+{
+    for (size_t i = 0; i != count; ++i)
+    {
+        out[i] = in[i] + value;
+    }
+}
+
+#ifdef CPU_BACKEND_AVX2
+CPU_BACKEND_AVX2 static void addScalarAvx2(const float *in, float *out, size_t count, float value)
+{
+    __m256 v = _mm256_set1_ps(value);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256 a = _mm256_loadu_ps(in + i);
+        __m256 b = _mm256_loadu_ps(in + i + 8);
+        __m256 c = _mm256_loadu_ps(in + i + 16);
+        __m256 d = _mm256_loadu_ps(in + i + 24);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(a, v));
+        _mm256_storeu_ps(out + i + 8, _mm256_add_ps(b, v));
+        _mm256_storeu_ps(out + i + 16, _mm256_add_ps(c, v));
+        _mm256_storeu_ps(out + i + 24, _mm256_add_ps(d, v));
+    }
+
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(in + i), v));
+    }
+
+    addScalarScalar(in + i, out + i, count - i, value);
+}
+#endif
+
+#ifdef CPU_BACKEND_NEON
+static void addScalarNeon(const float *in, float *out, size_t count, float value)
+{
+    float32x4_t v = vdupq_n_f32(value);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        float32x4_t a = vld1q_f32(in + i);
+        float32x4_t b = vld1q_f32(in + i + 4);
+        float32x4_t c = vld1q_f32(in + i + 8);
+        float32x4_t d = vld1q_f32(in + i + 12);
+        vst1q_f32(out + i, vaddq_f32(a, v));
+        vst1q_f32(out + i + 4, vaddq_f32(b, v));
+        vst1q_f32(out + i + 8, vaddq_f32(c, v));
+        vst1q_f32(out + i + 12, vaddq_f32(d, v));
+    }
+
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vaddq_f32(vld1q_f32(in + i), v));
+    }
+
+    addScalarScalar(in + i, out + i, count - i, value);
+}
+#endif
+
+CpuBackend::CpuBackend() : _addScalar(addScalarScalar), _isa("scalar")
+{
+#ifdef CPU_BACKEND_AVX2
+#if defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2"))
+#endif
+    {
+        _addScalar = addScalarAvx2;
+        _isa = "avx2";
+    }
+#endif
+
+#ifdef CPU_BACKEND_NEON
+    _addScalar = addScalarNeon;
+    _isa = "neon";
+#endif
+}
+
+void CpuBackend::addScalar(const float *in, float *out, size_t count, float value)
+{
+    size_t workers = std::min(_pool.size() + 1, count / MIN_PARALLEL_CHUNK);
+
+    if (workers <= 1)
+    {
+        _addScalar(in, out, count, value);
+        return;
+    }
+
+    // chunks start on 64 byte boundaries of the arrays
+    size_t chunk = (count / workers + 15) / 16 * 16;
+    AddScalarFunc func = _addScalar;
+    std::vector<std::future<void>> pending;
+
+    for (size_t begin = chunk; begin < count; begin += chunk)
+    {
+        size_t size = std::min(chunk, count - begin);
+
+        pending.push_back(_pool.submit([func, in, out, begin, size, value]
+        {
+            func(in + begin, out + begin, size, value);
+        }));
+    }
+
+    // the calling thread takes the first chunk
+    _addScalar(in, out, std::min(chunk, count), value);
+
+    for (auto &future : pending)
+    {
+        future.get();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef __VE_CPU_BACKEND_H__
+#define __VE_CPU_BACKEND_H__
+
+#include <cstddef>
+#include "Singleton.h"
+#include "ThreadPool.h"
+
+
+// Host implementations of the built-in kernels, vectorized with AVX2 or NEON where available and split
+// across a worker pool for large inputs. Used for small problems and on machines without a usable GPU.
+class CpuBackend : public Singleton<CpuBackend>
+{
+public:
+    CpuBackend();
+
+    // out[i] = in[i] + value, the host version of ComputeShader.comp; in and out may alias
+    void addScalar(const float *in, float *out, size_t count, float value);
+
+    // vector path chosen at startup: "avx2", "neon" or "scalar"
+    inline const char *getIsa() const
+    {
+        return _isa;
+    }
+
+    inline size_t getThreadCount() const
+    {
+        return _pool.size();
+    }
+
+private:
+    typedef void (*AddScalarFunc)(const float *in, float *out, size_t count, float value);
+
+    ThreadPool _pool;
+    AddScalarFunc _addScalar;
+    const char *_isa;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "ElementwiseDispatcher.h"
+#include "CpuBackend.h"
+#include "VulkanContext.h"
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+// local_size_x of ComputeShader.comp unless specialised through constant 0
+#define LOCAL_SIZE_X 256
+#define CALIBRATION_RUNS 3
+
+ElementwiseDispatcher::ElementwiseDispatcher(ComputeShader *shader, size_t threshold) : _shader(shader), _threshold(threshold)
+{
+    if (shader != nullptr)
+    {
+        auto it = shader->getSpecialization().find(0);
+        _localSizeX = it != shader->getSpecialization().end() ? it->second : LOCAL_SIZE_X;
+    }
+}
+
+DispatchTarget ElementwiseDispatcher::run(const float *in, float *out, size_t count, float value)
+{
+    DispatchTarget target = select(count);
+
+    if (target == DispatchGpu)
+    {
+        runGpu(in, out, count, value);
+    }
+    else
+    {
+        runCpu(in, out, count, value);
+    }
+
+    return target;
+}
+
+void ElementwiseDispatcher::runCpu(const float *in, float *out, size_t count, float value)
+{
+    CpuBackend::Instance().addScalar(in, out, count, value);
+}
+
+void ElementwiseDispatcher::runGpu(const float *in, float *out, size_t count, float value)
+{
+    // the shader works on vec4, a tail of fewer than 4 floats is finished on the host
+    size_t vectors = count / 4;
+
+    if (vectors != 0)
+    {
+        reserve(vectors);
+
+        _input->setData((void *)in, (uint64_t)vectors);
+
+        _shader->setUniform("ParameterUBO", "deltaTime", value);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkResetCommandBuffer(_commandBuffer, 0);
+
+        if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording dispatcher command buffer!");
+        }
+
+        // the shader's own bindings stay as the caller set them, this run uses a private descriptor set
+        _shader->record(_commandBuffer, (uint32_t)((vectors + _localSizeX - 1) / _localSizeX), 1, 1, _descriptorSet);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record dispatcher command buffer!");
+        }
+
+        VulkanContext::Instance().submit(_commandBuffer, _fence);
+        VulkanContext::Instance().waitForFence(_fence);
+        vkResetFences(VulkanContext::Instance().device, 1, &_fence);
+
+        _output->getData(out, (uint64_t)vectors);
+    }
+
+    runCpu(in + vectors * 4, out + vectors * 4, count - vectors * 4, value);
+}
+
+void ElementwiseDispatcher::reserve(size_t vectors)
+{
+    if (vectors <= _capacity)
+    {
+        return;
+    }
+
+    if (_commandBuffer == VK_NULL_HANDLE)
+    {
+        _commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(VulkanContext::Instance().device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create dispatcher fence!");
+        }
+    }
+
+    releaseBuffers();
+
+    // whole workgroups, the kernel has no bounds check
+    _capacity = (vectors + _localSizeX - 1) / _localSizeX * _localSizeX;
+    _input = new ComputeBuffer((uint64_t)_capacity, 16, Dynamic);
+    _output = new ComputeBuffer((uint64_t)_capacity, 16, Dynamic);
+    _descriptorSet = _shader->allocateDescriptorSet({{"ParticleSSBOIn", _input}, {"ParticleSSBOOut", _output}});
+}
+
+size_t ElementwiseDispatcher::calibrate(size_t maxCount)
+{
+    if (_shader == nullptr)
+    {
+        _threshold = std::numeric_limits<size_t>::max();
+        return _threshold;
+    }
+
+    std::vector<float> in(maxCount, 1.0f);
+    std::vector<float> out(maxCount);
+
+    auto best = [&](void (ElementwiseDispatcher::*path)(const float *, float *, size_t, float), size_t count)
+    {
+        double seconds = std::numeric_limits<double>::max();
+
+        for (int i = 0; i != CALIBRATION_RUNS; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            (this->*path)(in.data(), out.data(), count, 0.5f);
+            seconds = std::min(seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        return seconds;
+    };
+
+    _threshold = std::numeric_limits<size_t>::max();
+
+    for (size_t count = 4096; count <= maxCount; count *= 4)
+    {
+        if (best(&ElementwiseDispatcher::runGpu, count) < best(&ElementwiseDispatcher::runCpu, count))
+        {
+            _threshold = count;
+            break;
+        }
+    }
+
+    return _threshold;
+}
+
+void ElementwiseDispatcher::releaseBuffers()
+{
+    if (_input != nullptr)
+    {
+        _shader->freeDescriptorSet(_descriptorSet);
+        _input->release();
+        _output->release();
+        delete _input;
+        delete _output;
+    }
+
+    _descriptorSet = VK_NULL_HANDLE;
+    _input = nullptr;
+    _output = nullptr;
+    _capacity = 0;
+}
+
+void ElementwiseDispatcher::release()
+{
+    releaseBuffers();
+
+    if (_commandBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFence(VulkanContext::Instance().device, _fence, nullptr);
+        VulkanContext::Instance().freeCommandBuffer(_commandBuffer);
+    }
+
+    _commandBuffer = VK_NULL_HANDLE;
+    _fence = VK_NULL_HANDLE;
+}
@@ -0,0 +1,73 @@
+#ifndef __VE_ELEMENTWISE_DISPATCHER_H__
+#define __VE_ELEMENTWISE_DISPATCHER_H__
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+
+
+class ComputeShader;
+class ComputeBuffer;
+
+enum DispatchTarget
+{
+    DispatchCpu = 0,
+    DispatchGpu
+};
+
+// Runs the elementwise kernel of ComputeShader.comp on the CPU or the GPU depending on the problem size.
+// Inputs smaller than the threshold stay on the host, where a submit round trip would cost more than the work.
+// The GPU path records into its own command buffer with its own descriptor set, so it neither flushes the
+// shared VulkanContext command buffer nor changes the shader's ParticleSSBOIn/Out bindings; it does leave
+// deltaTime of the shared ParameterUBO block at the last value run.
+class ElementwiseDispatcher
+{
+public:
+    // shader = nullptr always uses the CPU, e.g. on nodes without a usable GPU
+    explicit ElementwiseDispatcher(ComputeShader *shader = nullptr, size_t threshold = 1 << 20);
+
+    // out[i] = in[i] + value for count floats
+    DispatchTarget run(const float *in, float *out, size_t count, float value);
+
+    inline DispatchTarget select(size_t count) const
+    {
+        return _shader != nullptr && count >= _threshold ? DispatchGpu : DispatchCpu;
+    }
+
+    // times both paths on growing sizes up to maxCount and moves the threshold to the first size the GPU wins
+    size_t calibrate(size_t maxCount = 1 << 24);
+
+    inline size_t getThreshold() const
+    {
+        return _threshold;
+    }
+
+    inline void setThreshold(size_t threshold)
+    {
+        _threshold = threshold;
+    }
+
+    void release();
+
+private:
+    ComputeShader *_shader;
+    size_t _threshold;
+    size_t _localSizeX = 0;
+
+    // vec4 elements the GPU buffers hold
+    size_t _capacity = 0;
+    ComputeBuffer *_input = nullptr;
+    ComputeBuffer *_output = nullptr;
+    VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+    VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+    VkFence _fence = VK_NULL_HANDLE;
+
+    void runCpu(const float *in, float *out, size_t count, float value);
+
+    void runGpu(const float *in, float *out, size_t count, float value);
+
+    void reserve(size_t vectors);
+
+    void releaseBuffers();
+};
+
+#endif
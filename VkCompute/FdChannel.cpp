@@ -0,0 +1,367 @@
+#ifndef _WIN32
+
+#include "FdChannel.h"
+#include "SharedFence.h"
+#include "VulkanContext.h"
+#include <stdexcept>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_CHANNEL_FDS 16
+
+// a vanished peer should throw, not raise SIGPIPE
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+    struct SharedBufferHeader
+    {
+        uint8_t deviceUUID[VK_UUID_SIZE];
+        uint8_t driverUUID[VK_UUID_SIZE];
+        uint64_t count;
+        uint64_t allocationSize;
+        uint32_t memoryTypeIndex;
+        int32_t stride;
+        int32_t usage;
+        int32_t hasFence;
+    };
+
+    void getDeviceIDs(SharedBufferHeader &header)
+    {
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+
+        vkGetPhysicalDeviceProperties2(VulkanContext::Instance().getPhysicalDevice(), &properties);
+
+        memcpy(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+        memcpy(header.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+    }
+
+    sockaddr_un socketAddress(const std::string &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            throw std::runtime_error("socket path too long: " + path);
+        }
+
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        return address;
+    }
+}
+
+FdChannel::FdChannel(int socket) : _socket(socket)
+{
+}
+
+FdChannel* FdChannel::accept(const std::string &path)
+{
+    int listener = listen(path, 1);
+
+    try
+    {
+        FdChannel *channel = accept(listener);
+
+        close(listener);
+        unlink(path.c_str());
+
+        return channel;
+    }
+    catch (const std::exception &)
+    {
+        close(listener);
+        unlink(path.c_str());
+        throw;
+    }
+}
+
+int FdChannel::listen(const std::string &path, int backlog)
+{
+    sockaddr_un address = socketAddress(path);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0)
+    {
+        throw std::runtime_error("failed to create socket!");
+    }
+
+    unlink(path.c_str());
+
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(listener, backlog) != 0)
+    {
+        close(listener);
+        throw std::runtime_error("failed to listen on " + path);
+    }
+
+    return listener;
+}
+
+FdChannel* FdChannel::accept(int listener)
+{
+    int peer = ::accept(listener, nullptr, nullptr);
+
+    if (peer < 0)
+    {
+        throw std::runtime_error("failed to accept connection!");
+    }
+
+    return new FdChannel(peer);
+}
+
+FdChannel* FdChannel::connect(const std::string &path, int timeoutMs)
+{
+    sockaddr_un address = socketAddress(path);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (true)
+    {
+        int peer = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (peer < 0)
+        {
+            throw std::runtime_error("failed to create socket!");
+        }
+
+        if (::connect(peer, (sockaddr *)&address, sizeof(address)) == 0)
+        {
+            return new FdChannel(peer);
+        }
+
+        close(peer);
+
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            throw std::runtime_error("failed to connect to " + path);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void FdChannel::send(const void *data, size_t size, const std::vector<int> &fds)
+{
+    if (fds.size() > MAX_CHANNEL_FDS || size == 0)
+    {
+        throw std::runtime_error("invalid channel message!");
+    }
+
+    char control[CMSG_SPACE(sizeof(int) * MAX_CHANNEL_FDS)] = {};
+
+    iovec iov{};
+    iov.iov_base = const_cast<void *>(data);
+    iov.iov_len = size;
+
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    // the descriptors ride along with the first byte
+    if (!fds.empty())
+    {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+    }
+
+    const char *bytes = (const char *)data;
+    size_t sent = 0;
+
+    while (sent < size)
+    {
+        ssize_t result = sendmsg(_socket, &message, MSG_NOSIGNAL);
+
+        if (result <= 0)
+        {
+            throw std::runtime_error("failed to send on channel!");
+        }
+
+        sent += (size_t)result;
+        iov.iov_base = const_cast<char *>(bytes + sent);
+        iov.iov_len = size - sent;
+        message.msg_control = nullptr;
+        message.msg_controllen = 0;
+    }
+}
+
+std::vector<int> FdChannel::receive(void *data, size_t size)
+{
+    std::vector<int> fds;
+    char control[CMSG_SPACE(sizeof(int) * MAX_CHANNEL_FDS)];
+
+    char *bytes = (char *)data;
+    size_t received = 0;
+
+    while (received < size)
+    {
+        iovec iov{};
+        iov.iov_base = bytes + received;
+        iov.iov_len = size - received;
+
+        msghdr message{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t result = recvmsg(_socket, &message, 0);
+
+        if (result <= 0)
+        {
+            throw std::runtime_error("failed to receive on channel!");
+        }
+
+        for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+        {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+            {
+                size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int *incoming = (const int *)CMSG_DATA(header);
+                fds.insert(fds.end(), incoming, incoming + count);
+            }
+        }
+
+        received += (size_t)result;
+    }
+
+    return fds;
+}
+
+void FdChannel::sendBuffer(ComputeBuffer *buffer, SharedFence *fence)
+{
+    SharedBufferHeader header{};
+    getDeviceIDs(header);
+    header.count = buffer->getCount();
+    header.stride = buffer->getStride();
+    header.usage = (int32_t)buffer->getUsage();
+    header.memoryTypeIndex = buffer->getMemoryTypeIndex();
+    header.allocationSize = buffer->getAllocationSize();
+    header.hasFence = fence != nullptr;
+
+    std::vector<int> fds = {buffer->exportFd()};
+
+    if (fence != nullptr)
+    {
+        fds.push_back(fence->exportFd());
+    }
+
+    try
+    {
+        send(&header, sizeof(header), fds);
+    }
+    catch (const std::exception &)
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+
+        throw;
+    }
+
+    for (int fd : fds)
+    {
+        close(fd);
+    }
+}
+
+ComputeBuffer* FdChannel::receiveBuffer(SharedFence **fence)
+{
+    SharedBufferHeader header{};
+    std::vector<int> fds = receive(&header, sizeof(header));
+
+    SharedBufferHeader local{};
+    getDeviceIDs(local);
+
+    if (fds.size() != (header.hasFence ? 2u : 1u) ||
+        memcmp(header.deviceUUID, local.deviceUUID, VK_UUID_SIZE) != 0 || memcmp(header.driverUUID, local.driverUUID, VK_UUID_SIZE) != 0)
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+
+        throw std::runtime_error("shared buffer comes from a different device or driver!");
+    }
+
+    ComputeBuffer *buffer = nullptr;
+
+    try
+    {
+        buffer = ComputeBuffer::importFd(fds[0], header.count, header.stride, (ComputeBufferMode)header.usage,
+                                         header.memoryTypeIndex, header.allocationSize);
+        fds[0] = -1;
+
+        if (header.hasFence)
+        {
+            SharedFence *shared = new SharedFence(fds[1]);
+            fds[1] = -1;
+
+            if (fence != nullptr)
+            {
+                *fence = shared;
+            }
+            else
+            {
+                shared->release();
+                delete shared;
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        if (buffer != nullptr)
+        {
+            buffer->release();
+            delete buffer;
+        }
+
+        throw;
+    }
+
+    return buffer;
+}
+
+void FdChannel::shutdown()
+{
+    if (_socket >= 0)
+    {
+        ::shutdown(_socket, SHUT_RDWR);
+    }
+}
+
+void FdChannel::release()
+{
+    if (_socket >= 0)
+    {
+        close(_socket);
+        _socket = -1;
+    }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __VE_FD_CHANNEL_H__
+#define __VE_FD_CHANNEL_H__
+
+#include <string>
+#include <vector>
+#include "ComputeBuffer.h"
+
+
+class SharedFence;
+
+// Unix domain socket between two local processes that carries file descriptors (SCM_RIGHTS) next to
+// fixed size messages, used to share exported ComputeBuffers and SharedFences. Not available on Windows.
+class FdChannel
+{
+public:
+    // bind path, replacing a stale socket file, and block until one peer connects
+    static FdChannel* accept(const std::string &path);
+
+    // listening socket for servers taking several peers, closed and unlinked by the caller
+    static int listen(const std::string &path, int backlog = 16);
+
+    // blocks until a peer connects to listener
+    static FdChannel* accept(int listener);
+
+    // retries until the server listens or timeoutMs has passed
+    static FdChannel* connect(const std::string &path, int timeoutMs = 5000);
+
+    // the peer gets its own duplicates, the caller still closes fds
+    void send(const void *data, size_t size, const std::vector<int> &fds = {});
+
+    // blocks until size bytes arrived, returns the descriptors sent with them, owned by the caller
+    std::vector<int> receive(void *data, size_t size);
+
+    // export buffer and optionally fence with everything the peer needs to import them
+    void sendBuffer(ComputeBuffer *buffer, SharedFence *fence = nullptr);
+
+    // import what sendBuffer sent, fence is set when one was sent; both processes must use the same device and driver
+    ComputeBuffer* receiveBuffer(SharedFence **fence = nullptr);
+
+    // unblocks a receive in another thread, which then throws
+    void shutdown();
+
+    void release();
+
+private:
+    explicit FdChannel(int socket);
+
+    int _socket;
+};
+
+#endif
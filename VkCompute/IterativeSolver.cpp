@@ -0,0 +1,197 @@
+#include "IterativeSolver.h"
+#include "ComputeShader.h"
+#include "ComputeBuffer.h"
+#include "VulkanContext.h"
+
+// uint words of the control buffer, matching SolverControl in res/shaders/Solver.glsl
+#define CONTROL_ARGS 0
+#define CONTROL_NEXT 4
+#define CONTROL_ITERATIONS 8
+#define CONTROL_WORDS 12
+
+// indirect dispatches cannot be split like ComputeShader::record does, the counts must fit one dispatch
+static void checkIndirectGroups(const uint32_t groups[3])
+{
+    const uint32_t *maxGroups = VulkanContext::Instance().getProperties().limits.maxComputeWorkGroupCount;
+
+    if (groups[0] > maxGroups[0] || groups[1] > maxGroups[1] || groups[2] > maxGroups[2])
+    {
+        throw std::runtime_error("solver group count exceeds maxComputeWorkGroupCount, indirect dispatches cannot be split!");
+    }
+}
+
+IterativeSolver::IterativeSolver(ComputeShader *shader, const std::string &input, const std::string &output, ComputeBuffer *a, ComputeBuffer *b,
+                                 uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ, const std::string &control)
+    : _shader(shader), _buffers{a, b}, _groups{threadGroupsX, threadGroupsY, threadGroupsZ}
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    if (!control.empty())
+    {
+        _control = new ComputeBuffer(CONTROL_WORDS, sizeof(uint32_t), Dynamic);
+        shader->setBuffer(control, _control);
+    }
+
+    // a -> b and b -> a
+    for (int i = 0; i != 2; ++i)
+    {
+        shader->setBuffer(input, _buffers[i]);
+        shader->setBuffer(output, _buffers[1 - i]);
+        _descriptorSets[i] = shader->snapshotDescriptorSet();
+    }
+
+    _commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create solver fence!");
+    }
+}
+
+void IterativeSolver::record(int iterations)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    vkResetCommandBuffer(_commandBuffer, 0);
+
+    if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording solver command buffer!");
+    }
+
+    VkMemoryBarrier stepBarrier{};
+    stepBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    stepBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    stepBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkMemoryBarrier transferBarrier{};
+    transferBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    transferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    transferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    VkBuffer control = VK_NULL_HANDLE;
+
+    if (_control != nullptr)
+    {
+        checkIndirectGroups(_groups);
+        control = _control->getBuffer();
+    }
+
+    for (int i = 0; i != iterations; ++i)
+    {
+        VkDescriptorSet descriptorSet = _descriptorSets[i % 2];
+
+        if (_control == nullptr)
+        {
+            _shader->record(_commandBuffer, _groups[0], _groups[1], _groups[2], descriptorSet);
+            vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 1, &stepBarrier, 0, nullptr, 0, nullptr);
+            continue;
+        }
+
+        // next.x = 0, a workgroup that has not converged raises it back to the group count
+        vkCmdFillBuffer(_commandBuffer, control, CONTROL_NEXT * sizeof(uint32_t), sizeof(uint32_t), 0);
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &transferBarrier, 0, nullptr, 0, nullptr);
+
+        _shader->recordIndirect(_commandBuffer, control, CONTROL_ARGS * sizeof(uint32_t), descriptorSet);
+
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &stepBarrier, 0, nullptr, 0, nullptr);
+
+        // the group count of the next iteration, 0 once converged
+        VkBufferCopy region{};
+        region.srcOffset = CONTROL_NEXT * sizeof(uint32_t);
+        region.dstOffset = CONTROL_ARGS * sizeof(uint32_t);
+        region.size = 3 * sizeof(uint32_t);
+        vkCmdCopyBuffer(_commandBuffer, control, control, 1, &region);
+
+        vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &transferBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    VkMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record solver command buffer!");
+    }
+
+    _recorded = iterations;
+}
+
+void IterativeSolver::resetControl()
+{
+    checkIndirectGroups(_groups);
+
+    uint32_t words[CONTROL_WORDS] = {};
+
+    words[CONTROL_ARGS + 0] = _groups[0];
+    words[CONTROL_ARGS + 1] = _groups[1];
+    words[CONTROL_ARGS + 2] = _groups[2];
+    words[CONTROL_NEXT + 1] = _groups[1];
+    words[CONTROL_NEXT + 2] = _groups[2];
+
+    _control->setData(words, CONTROL_WORDS);
+}
+
+int IterativeSolver::run()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    if (_control != nullptr)
+    {
+        resetControl();
+    }
+
+    VulkanContext::Instance().submit(_commandBuffer, _fence);
+    VulkanContext::Instance().waitForFence(_fence);
+    vkResetFences(device, 1, &_fence);
+
+    if (_control != nullptr)
+    {
+        uint32_t iterations;
+        _control->getData(&iterations, 1, CONTROL_ITERATIONS);
+        _iterations = (int)iterations;
+    }
+    else
+    {
+        _iterations = _recorded;
+    }
+
+    return _iterations;
+}
+
+ComputeBuffer *IterativeSolver::getResult()
+{
+    // iteration i writes buffer (i + 1) % 2
+    return _iterations == 0 ? _buffers[0] : _buffers[_iterations % 2];
+}
+
+void IterativeSolver::release()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    _shader->freeDescriptorSet(_descriptorSets[0]);
+    _shader->freeDescriptorSet(_descriptorSets[1]);
+
+    vkDestroyFence(device, _fence, nullptr);
+    VulkanContext::Instance().freeCommandBuffer(_commandBuffer);
+
+    if (_control != nullptr)
+    {
+        _control->release();
+        delete _control;
+        _control = nullptr;
+    }
+}
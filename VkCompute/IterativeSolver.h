@@ -0,0 +1,53 @@
+#ifndef __VE_ITERATIVE_SOLVER_H__
+#define __VE_ITERATIVE_SOLVER_H__
+
+#include <vulkan/vulkan.h>
+#include <string>
+
+
+class ComputeShader;
+class ComputeBuffer;
+
+// Runs up to N iterations of a kernel in one submission, swapping input and output between a and b through two
+// prebuilt descriptor sets. With a control binding the kernel reports convergence through res/shaders/Solver.glsl:
+// each iteration is an indirect dispatch whose group count the previous iteration wrote, so once no workgroup asks
+// for another step the remaining iterations dispatch nothing and the host never reads back in between.
+class IterativeSolver
+{
+public:
+    // buffers other than input, output and control keep what was set on the shader before construction
+    IterativeSolver(ComputeShader *shader, const std::string &input, const std::string &output, ComputeBuffer *a, ComputeBuffer *b,
+                    uint32_t threadGroupsX, uint32_t threadGroupsY = 1, uint32_t threadGroupsZ = 1, const std::string &control = "");
+
+    // record up to iterations steps, the first one reading a
+    void record(int iterations);
+
+    // submit, wait and return the number of iterations that ran
+    int run();
+
+    // a or b, whichever the last executed iteration wrote
+    ComputeBuffer *getResult();
+
+    inline int getIterations() const
+    {
+        return _iterations;
+    }
+
+    void release();
+
+private:
+    ComputeShader *_shader;
+    ComputeBuffer *_buffers[2];
+    ComputeBuffer *_control = nullptr;
+    VkDescriptorSet _descriptorSets[2];
+    uint32_t _groups[3];
+    int _recorded = 0;
+    int _iterations = 0;
+
+    VkCommandBuffer _commandBuffer;
+    VkFence _fence;
+
+    void resetControl();
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef _WIN32
+
+#include "JobClient.h"
+#include "FdChannel.h"
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+JobClient::JobClient(const std::string &path, size_t capacity) : _capacity(capacity)
+{
+    // anonymous shared memory: the name is only needed until the fd is open
+    std::string name = "/vkcompute-job-" + std::to_string(getpid()) + "-" + std::to_string((uintptr_t)this);
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to create shared memory!");
+    }
+
+    shm_unlink(name.c_str());
+
+    size_t size = capacity * sizeof(float);
+    void *mapped = ftruncate(fd, (off_t)size) == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if (mapped == MAP_FAILED)
+    {
+        close(fd);
+        throw std::runtime_error("failed to map shared memory!");
+    }
+
+    _shared = (float *)mapped;
+
+    try
+    {
+        _channel = FdChannel::connect(path);
+
+        JobRequest attach{};
+        attach.id = _nextId++;
+        attach.op = JobAttach;
+        attach.count = (uint32_t)capacity;
+
+        _channel->send(&attach, sizeof(attach), {fd});
+        close(fd);
+        fd = -1;
+
+        JobReply reply{};
+        _channel->receive(&reply, sizeof(reply));
+
+        if (reply.status != 0)
+        {
+            throw std::runtime_error("server failed to map shared memory!");
+        }
+    }
+    catch (const std::exception &)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        release();
+        throw;
+    }
+}
+
+JobReply JobClient::add(uint32_t offset, uint32_t count, float value)
+{
+    return call(JobAdd, offset, count, value);
+}
+
+JobReply JobClient::sum(uint32_t offset, uint32_t count)
+{
+    return call(JobSum, offset, count, 0.0f);
+}
+
+JobReply JobClient::call(uint32_t op, uint32_t offset, uint32_t count, float value)
+{
+    if ((uint64_t)offset + count > _capacity)
+    {
+        throw std::runtime_error("job exceeds the shared region!");
+    }
+
+    JobRequest request{};
+    request.id = _nextId++;
+    request.op = op;
+    request.offset = offset;
+    request.count = count;
+    request.value = value;
+
+    _channel->send(&request, sizeof(request));
+
+    JobReply reply{};
+    _channel->receive(&reply, sizeof(reply));
+
+    if (reply.id != request.id || reply.status != 0)
+    {
+        throw std::runtime_error("job failed on the server!");
+    }
+
+    return reply;
+}
+
+JobServerStats JobClient::stats()
+{
+    JobRequest request{};
+    request.id = _nextId++;
+    request.op = JobStats;
+
+    _channel->send(&request, sizeof(request));
+
+    JobServerStats stats{};
+    _channel->receive(&stats, sizeof(stats));
+
+    return stats;
+}
+
+void JobClient::release()
+{
+    if (_channel != nullptr)
+    {
+        _channel->release();
+        delete _channel;
+        _channel = nullptr;
+    }
+
+    if (_shared != nullptr)
+    {
+        munmap(_shared, _capacity * sizeof(float));
+        _shared = nullptr;
+    }
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __VE_JOB_CLIENT_H__
+#define __VE_JOB_CLIENT_H__
+
+#include <string>
+#include "JobProtocol.h"
+
+
+class FdChannel;
+
+// Client of a JobServer. Owns a shared memory region the server maps once, so job data never crosses the
+// socket; one job is in flight at a time, use a client per thread or process. Not available on Windows.
+class JobClient
+{
+public:
+    // capacity in floats of the shared region, the largest job this client can send
+    JobClient(const std::string &path, size_t capacity = 1 << 20);
+
+    // shared region, fill it and pass offsets to the jobs
+    inline float* data()
+    {
+        return _shared;
+    }
+
+    inline size_t getCapacity() const
+    {
+        return _capacity;
+    }
+
+    // data[offset + i] += value on the server's GPU, in place
+    JobReply add(uint32_t offset, uint32_t count, float value);
+
+    // reply.result is the sum of data[offset, offset + count)
+    JobReply sum(uint32_t offset, uint32_t count);
+
+    JobServerStats stats();
+
+    void release();
+
+private:
+    FdChannel *_channel = nullptr;
+    float *_shared = nullptr;
+    size_t _capacity;
+    uint64_t _nextId = 0;
+
+    JobReply call(uint32_t op, uint32_t offset, uint32_t count, float value);
+};
+
+#endif
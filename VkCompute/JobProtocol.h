@@ -0,0 +1,45 @@
+#ifndef __VE_JOB_PROTOCOL_H__
+#define __VE_JOB_PROTOCOL_H__
+
+#include <cstdint>
+
+// Messages between JobClient and JobServer over an FdChannel. A client first attaches a shared memory
+// region of floats (JobAttach, the fd travels with the message); jobs then name a range of that region,
+// which the server reads the input from and, for JobAdd, writes the result back into.
+enum JobOp
+{
+    JobAttach = 0,
+    JobAdd,   // data[i] += value
+    JobSum,   // result = sum of data
+    JobStats  // answered with JobServerStats instead of JobReply
+};
+
+struct JobRequest
+{
+    uint64_t id;
+    uint32_t op;
+    uint32_t offset; // floats into the attached region
+    uint32_t count;
+    float value;
+};
+
+struct JobReply
+{
+    uint64_t id;
+    int32_t status; // 0 on success
+    float result;
+    double queueSeconds;   // waiting for a batch
+    double executeSeconds; // the batch submission the job was part of
+};
+
+// percentiles are 50, 90 and 99 over the most recent jobs
+struct JobServerStats
+{
+    uint64_t jobs;
+    uint64_t batches;
+    uint64_t clients;
+    double queueSeconds[3];
+    double executeSeconds[3];
+};
+
+#endif
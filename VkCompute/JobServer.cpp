@@ -0,0 +1,370 @@
+#ifndef _WIN32
+
+#include "JobServer.h"
+#include "FdChannel.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_LATENCY_SAMPLES 65536
+
+JobServer::Client::~Client()
+{
+    if (shared != nullptr)
+    {
+        munmap(shared, capacity * sizeof(float));
+    }
+
+    if (channel != nullptr)
+    {
+        channel->release();
+        delete channel;
+    }
+}
+
+JobServer::JobServer(const std::string &path, size_t maxBatch, double batchWindow, const std::string &shaderDirectory)
+    : _path(path), _maxBatch(std::max<size_t>(maxBatch, 1)), _batchWindow(batchWindow), _kernels(shaderDirectory)
+{
+}
+
+void JobServer::run()
+{
+    _listener = FdChannel::listen(_path);
+    _running = true;
+    _acceptor = std::thread(&JobServer::accept, this);
+
+    std::vector<Job> jobs;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            _condition.wait(lock, [this] { return !_queue.empty() || !_running; });
+
+            if (!_running)
+            {
+                break;
+            }
+
+            // give other clients the chance to join this batch
+            auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_batchWindow));
+            _condition.wait_until(lock, deadline, [this] { return _queue.size() >= _maxBatch || !_running; });
+
+            size_t count = std::min(_queue.size(), _maxBatch);
+            jobs.assign(_queue.begin(), _queue.begin() + count);
+            _queue.erase(_queue.begin(), _queue.begin() + count);
+        }
+
+        execute(jobs);
+        jobs.clear();
+    }
+
+    // wakes the acceptor, then every reader
+    ::shutdown(_listener, SHUT_RDWR);
+    _acceptor.join();
+    close(_listener);
+    unlink(_path.c_str());
+    _listener = -1;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for (auto &client : _clients)
+    {
+        client->channel->shutdown();
+    }
+
+    _condition.wait(lock, [this] { return _readers == 0; });
+
+    _clients.clear();
+    _queue.clear();
+}
+
+void JobServer::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _running = false;
+    _condition.notify_all();
+}
+
+void JobServer::accept()
+{
+    while (_running)
+    {
+        FdChannel *channel = nullptr;
+
+        try
+        {
+            channel = FdChannel::accept(_listener);
+        }
+        catch (const std::exception &)
+        {
+            // the listener was shut down
+            break;
+        }
+
+        auto client = std::make_shared<Client>();
+        client->channel = channel;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (!_running)
+        {
+            break;
+        }
+
+        _clients.push_back(client);
+        _readers++;
+
+        std::thread(&JobServer::read, this, client).detach();
+    }
+}
+
+void JobServer::read(std::shared_ptr<Client> client)
+{
+    try
+    {
+        while (true)
+        {
+            JobRequest request{};
+            std::vector<int> fds = client->channel->receive(&request, sizeof(request));
+
+            if (request.op == JobAttach && fds.size() == 1 && client->shared == nullptr)
+            {
+                // a region smaller than it claims would fault the executor on the first job past its end
+                size_t size = (size_t)request.count * sizeof(float);
+                struct stat status{};
+                void *mapped = MAP_FAILED;
+
+                if (size != 0 && fstat(fds[0], &status) == 0 && (uint64_t)status.st_size >= size)
+                {
+                    mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+                }
+
+                close(fds[0]);
+
+                JobReply attached{};
+                attached.id = request.id;
+                attached.status = mapped == MAP_FAILED ? -1 : 0;
+
+                if (mapped != MAP_FAILED)
+                {
+                    client->shared = (float *)mapped;
+                    client->capacity = request.count;
+                }
+
+                reply(*client, attached);
+                continue;
+            }
+
+            for (int fd : fds)
+            {
+                close(fd);
+            }
+
+            if (request.op == JobStats)
+            {
+                JobServerStats stats = getStats();
+
+                std::lock_guard<std::mutex> lock(client->sendMutex);
+                client->channel->send(&stats, sizeof(stats));
+                continue;
+            }
+
+            if ((request.op != JobAdd && request.op != JobSum) || client->shared == nullptr ||
+                (uint64_t)request.offset + request.count > client->capacity)
+            {
+                JobReply rejected{};
+                rejected.id = request.id;
+                rejected.status = -1;
+
+                reply(*client, rejected);
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _queue.push_back({client, request, Clock::now()});
+            _condition.notify_all();
+        }
+    }
+    catch (const std::exception &)
+    {
+        // the client disconnected or the server is stopping
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+    _readers--;
+    _condition.notify_all();
+}
+
+void JobServer::execute(std::vector<Job> &jobs)
+{
+    Clock::time_point start = Clock::now();
+
+    std::vector<float> results(jobs.size(), 0.0f);
+    int32_t status = 0;
+
+    try
+    {
+        // every add of the batch in one dispatch, then every sum in another
+        std::vector<size_t> adds;
+        std::vector<size_t> sums;
+        std::vector<float> values;
+
+        _in.clear();
+
+        for (size_t i = 0; i != jobs.size(); ++i)
+        {
+            const JobRequest &request = jobs[i].request;
+
+            if (request.op == JobAdd)
+            {
+                _in.add(jobs[i].client->shared + request.offset, request.count);
+                values.push_back(request.value);
+                adds.push_back(i);
+            }
+        }
+
+        if (!adds.empty())
+        {
+            _kernels.add(_in, values, _out);
+
+            for (size_t s = 0; s != adds.size(); ++s)
+            {
+                const Job &job = jobs[adds[s]];
+                memcpy(job.client->shared + job.request.offset, _out.data((int)s), (size_t)job.request.count * sizeof(float));
+            }
+        }
+
+        _in.clear();
+
+        for (size_t i = 0; i != jobs.size(); ++i)
+        {
+            const JobRequest &request = jobs[i].request;
+
+            if (request.op == JobSum)
+            {
+                _in.add(jobs[i].client->shared + request.offset, request.count);
+                sums.push_back(i);
+            }
+        }
+
+        if (!sums.empty())
+        {
+            std::vector<float> totals = _kernels.reduce(_in);
+
+            for (size_t s = 0; s != sums.size(); ++s)
+            {
+                results[sums[s]] = totals[s];
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        status = -1;
+    }
+
+    Clock::time_point end = Clock::now();
+    double executeSeconds = std::chrono::duration<double>(end - start).count();
+
+    for (size_t i = 0; i != jobs.size(); ++i)
+    {
+        JobReply done{};
+        done.id = jobs[i].request.id;
+        done.status = status;
+        done.result = results[i];
+        done.queueSeconds = std::chrono::duration<double>(start - jobs[i].queued).count();
+        done.executeSeconds = executeSeconds;
+
+        reply(*jobs[i].client, done);
+        record(done.queueSeconds, executeSeconds);
+    }
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+    _batches++;
+}
+
+void JobServer::reply(Client &client, const JobReply &reply)
+{
+    std::lock_guard<std::mutex> lock(client.sendMutex);
+
+    try
+    {
+        client.channel->send(&reply, sizeof(reply));
+    }
+    catch (const std::exception &)
+    {
+        // the client is gone, its reader cleans up
+    }
+}
+
+void JobServer::record(double queueSeconds, double executeSeconds)
+{
+    std::lock_guard<std::mutex> lock(_statsMutex);
+
+    if (_queueSamples.size() < MAX_LATENCY_SAMPLES)
+    {
+        _queueSamples.push_back(queueSeconds);
+        _executeSamples.push_back(executeSeconds);
+    }
+    else
+    {
+        _queueSamples[_nextSample] = queueSeconds;
+        _executeSamples[_nextSample] = executeSeconds;
+        _nextSample = (_nextSample + 1) % MAX_LATENCY_SAMPLES;
+    }
+
+    _jobs++;
+}
+
+static void percentiles(std::vector<double> samples, double out[3])
+{
+    const double ranks[3] = {0.5, 0.9, 0.99};
+
+    for (int i = 0; i != 3; ++i)
+    {
+        out[i] = 0.0;
+
+        if (!samples.empty())
+        {
+            size_t k = std::min(samples.size() - 1, (size_t)(ranks[i] * samples.size()));
+            std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+            out[i] = samples[k];
+        }
+    }
+}
+
+JobServerStats JobServer::getStats()
+{
+    JobServerStats stats{};
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        stats.clients = _clients.size();
+    }
+
+    std::lock_guard<std::mutex> lock(_statsMutex);
+
+    stats.jobs = _jobs;
+    stats.batches = _batches;
+    percentiles(_queueSamples, stats.queueSeconds);
+    percentiles(_executeSamples, stats.executeSeconds);
+
+    return stats;
+}
+
+void JobServer::release()
+{
+    _in.release();
+    _out.release();
+    _kernels.release();
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef __VE_JOB_SERVER_H__
+#define __VE_JOB_SERVER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include "JobProtocol.h"
+#include "BatchKernels.h"
+#include "SegmentBatch.h"
+
+
+class FdChannel;
+
+// Daemon side of the job protocol: one process owns the VulkanContext and serves kernel jobs from many
+// client processes over a Unix domain socket. Jobs that arrive together, from any client, are coalesced
+// into one BatchKernels submission. Not available on Windows.
+class JobServer
+{
+public:
+    // once a job is queued the executor waits up to batchWindow seconds for more, or until maxBatch are queued;
+    // the VulkanContext must be initialized first
+    JobServer(const std::string &path, size_t maxBatch = 4096, double batchWindow = 0.0005, const std::string &shaderDirectory = "../res/shaders/");
+
+    // accept clients and execute their jobs until stop(), on the thread that uses the VulkanContext
+    void run();
+
+    // thread safe, run() returns once the current batch is done
+    void stop();
+
+    JobServerStats getStats();
+
+    void release();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // lives until its reader is gone and no queued job refers to it
+    struct Client
+    {
+        FdChannel *channel = nullptr;
+        std::mutex sendMutex;
+        float *shared = nullptr;
+        size_t capacity = 0;
+
+        ~Client();
+    };
+
+    struct Job
+    {
+        std::shared_ptr<Client> client;
+        JobRequest request;
+        Clock::time_point queued;
+    };
+
+    std::string _path;
+    size_t _maxBatch;
+    double _batchWindow;
+    BatchKernels _kernels;
+    SegmentBatch _in;
+    SegmentBatch _out;
+
+    int _listener = -1;
+    std::atomic<bool> _running{false};
+    std::thread _acceptor;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<Job> _queue;
+    std::vector<std::shared_ptr<Client>> _clients;
+    size_t _readers = 0;
+
+    // latency samples of the most recent jobs, a ring once full
+    std::mutex _statsMutex;
+    std::vector<double> _queueSamples;
+    std::vector<double> _executeSamples;
+    size_t _nextSample = 0;
+    uint64_t _jobs = 0;
+    uint64_t _batches = 0;
+
+    void accept();
+
+    void read(std::shared_ptr<Client> client);
+
+    void execute(std::vector<Job> &jobs);
+
+    void reply(Client &client, const JobReply &reply);
+
+    void record(double queueSeconds, double executeSeconds);
+};
+
+#endif
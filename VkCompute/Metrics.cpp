@@ -0,0 +1,210 @@
+#include "Metrics.h"
+#include "VulkanContext.h"
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+static std::vector<double> sizeBuckets()
+{
+    // 4KB .. 1GB in powers of four
+    std::vector<double> bounds;
+    for (double bound = 4096.0; bound <= 1073741824.0; bound *= 4.0)
+    {
+        bounds.push_back(bound);
+    }
+    return bounds;
+}
+
+static std::vector<double> timeBuckets()
+{
+    return {0.00001, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1.0, 5.0};
+}
+
+Histogram::Histogram(const std::vector<double> &bounds) : _bounds(bounds), _counts(new std::atomic<uint64_t>[bounds.size() + 1])
+{
+    for (size_t i = 0; i != _bounds.size() + 1; ++i)
+    {
+        _counts[i] = 0;
+    }
+}
+
+void Histogram::observe(double value)
+{
+    size_t i = 0;
+    while (i != _bounds.size() && value > _bounds[i])
+    {
+        ++i;
+    }
+
+    _counts[i].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+
+    double sum = _sum.load(std::memory_order_relaxed);
+    while (!_sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+    {
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot result;
+    result.bounds = _bounds;
+
+    for (size_t i = 0; i != _bounds.size() + 1; ++i)
+    {
+        result.counts.push_back(_counts[i].load(std::memory_order_relaxed));
+    }
+
+    result.count = _count.load(std::memory_order_relaxed);
+    result.sum = _sum.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+Metrics::Metrics() : _allocationBytes(sizeBuckets()), _transferBytes(sizeBuckets()), _fenceWaitSeconds(timeBuckets()), _queueIdleWaitSeconds(timeBuckets())
+{
+    for (auto &live : _liveBytes)
+    {
+        live = 0;
+    }
+}
+
+void Metrics::recordAllocation(uint32_t memoryType, VkDeviceSize size)
+{
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    _liveBytes[memoryType].fetch_add((int64_t)size, std::memory_order_relaxed);
+    _allocationBytes.observe((double)size);
+}
+
+void Metrics::recordFree(uint32_t memoryType, VkDeviceSize size)
+{
+    _frees.fetch_add(1, std::memory_order_relaxed);
+    _liveBytes[memoryType].fetch_sub((int64_t)size, std::memory_order_relaxed);
+}
+
+void Metrics::recordUpload(size_t size)
+{
+    _uploads.fetch_add(1, std::memory_order_relaxed);
+    _bytesUploaded.fetch_add(size, std::memory_order_relaxed);
+    _transferBytes.observe((double)size);
+}
+
+void Metrics::recordDownload(size_t size)
+{
+    _downloads.fetch_add(1, std::memory_order_relaxed);
+    _bytesDownloaded.fetch_add(size, std::memory_order_relaxed);
+    _transferBytes.observe((double)size);
+}
+
+void Metrics::recordFenceWait(double seconds)
+{
+    _fenceWaits.fetch_add(1, std::memory_order_relaxed);
+    _fenceWaitSeconds.observe(seconds);
+}
+
+void Metrics::recordQueueIdleWait(double seconds)
+{
+    _queueIdleWaits.fetch_add(1, std::memory_order_relaxed);
+    _queueIdleWaitSeconds.observe(seconds);
+}
+
+MetricsSnapshot Metrics::snapshot() const
+{
+    MetricsSnapshot result;
+
+    result.allocations = _allocations.load(std::memory_order_relaxed);
+    result.frees = _frees.load(std::memory_order_relaxed);
+    result.uploads = _uploads.load(std::memory_order_relaxed);
+    result.bytesUploaded = _bytesUploaded.load(std::memory_order_relaxed);
+    result.downloads = _downloads.load(std::memory_order_relaxed);
+    result.bytesDownloaded = _bytesDownloaded.load(std::memory_order_relaxed);
+    result.submits = _submits.load(std::memory_order_relaxed);
+    result.fenceWaits = _fenceWaits.load(std::memory_order_relaxed);
+    result.queueIdleWaits = _queueIdleWaits.load(std::memory_order_relaxed);
+
+    result.memoryTypeCount = VulkanContext::Instance().getMemoryProperties().memoryTypeCount;
+
+    for (uint32_t i = 0; i != VK_MAX_MEMORY_TYPES; ++i)
+    {
+        result.liveBytes[i] = _liveBytes[i].load(std::memory_order_relaxed);
+    }
+
+    result.allocationBytes = _allocationBytes.snapshot();
+    result.transferBytes = _transferBytes.snapshot();
+    result.fenceWaitSeconds = _fenceWaitSeconds.snapshot();
+    result.queueIdleWaitSeconds = _queueIdleWaitSeconds.snapshot();
+
+    return result;
+}
+
+static void writeCounter(std::ostream &out, const char *name, const char *help, uint64_t value)
+{
+    out << "# HELP vkcompute_" << name << " " << help << "\n";
+    out << "# TYPE vkcompute_" << name << " counter\n";
+    out << "vkcompute_" << name << " " << value << "\n";
+}
+
+static void writeHistogram(std::ostream &out, const char *name, const char *help, const HistogramSnapshot &histogram)
+{
+    out << "# HELP vkcompute_" << name << " " << help << "\n";
+    out << "# TYPE vkcompute_" << name << " histogram\n";
+
+    uint64_t cumulative = 0;
+
+    for (size_t i = 0; i != histogram.bounds.size(); ++i)
+    {
+        cumulative += histogram.counts[i];
+        out << "vkcompute_" << name << "_bucket{le=\"" << histogram.bounds[i] << "\"} " << cumulative << "\n";
+    }
+
+    out << "vkcompute_" << name << "_bucket{le=\"+Inf\"} " << histogram.count << "\n";
+    out << "vkcompute_" << name << "_sum " << histogram.sum << "\n";
+    out << "vkcompute_" << name << "_count " << histogram.count << "\n";
+}
+
+void Metrics::writePrometheus(std::ostream &out, const MetricsSnapshot &snapshot)
+{
+    writeCounter(out, "memory_allocations_total", "vkAllocateMemory calls.", snapshot.allocations);
+    writeCounter(out, "memory_frees_total", "vkFreeMemory calls.", snapshot.frees);
+    writeCounter(out, "uploads_total", "Host to device writes through setData.", snapshot.uploads);
+    writeCounter(out, "upload_bytes_total", "Bytes written through setData.", snapshot.bytesUploaded);
+    writeCounter(out, "downloads_total", "Device to host reads through getData and readAsync.", snapshot.downloads);
+    writeCounter(out, "download_bytes_total", "Bytes read through getData and readAsync.", snapshot.bytesDownloaded);
+    writeCounter(out, "submits_total", "Queue submissions.", snapshot.submits);
+    writeCounter(out, "fence_waits_total", "Blocking vkWaitForFences calls.", snapshot.fenceWaits);
+    writeCounter(out, "queue_idle_waits_total", "Blocking vkQueueWaitIdle calls.", snapshot.queueIdleWaits);
+
+    out << "# HELP vkcompute_device_memory_live_bytes Allocated device memory by memory type.\n";
+    out << "# TYPE vkcompute_device_memory_live_bytes gauge\n";
+
+    for (uint32_t i = 0; i != snapshot.memoryTypeCount; ++i)
+    {
+        out << "vkcompute_device_memory_live_bytes{memory_type=\"" << i << "\"} " << snapshot.liveBytes[i] << "\n";
+    }
+
+    writeHistogram(out, "allocation_bytes", "Size of device memory allocations.", snapshot.allocationBytes);
+    writeHistogram(out, "transfer_bytes", "Size of host transfers.", snapshot.transferBytes);
+    writeHistogram(out, "fence_wait_seconds", "Time blocked in vkWaitForFences.", snapshot.fenceWaitSeconds);
+    writeHistogram(out, "queue_idle_wait_seconds", "Time blocked in vkQueueWaitIdle.", snapshot.queueIdleWaitSeconds);
+}
+
+void Metrics::exportPrometheus(const std::string &filename) const
+{
+    std::string temporary = filename + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open metrics file!");
+        }
+
+        writePrometheus(file, snapshot());
+    }
+
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        throw std::runtime_error("failed to write metrics file!");
+    }
+}
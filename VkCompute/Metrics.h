@@ -0,0 +1,111 @@
+#ifndef __VE_METRICS_H__
+#define __VE_METRICS_H__
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+#include "Singleton.h"
+
+
+struct HistogramSnapshot
+{
+    std::vector<double> bounds;
+    // counts[i] observations <= bounds[i], the last entry is the +Inf bucket; not cumulative
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    double sum = 0.0;
+};
+
+// fixed upper bounds, lock free observe
+class Histogram
+{
+public:
+    explicit Histogram(const std::vector<double> &bounds);
+
+    void observe(double value);
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    std::vector<double> _bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> _counts;
+    std::atomic<uint64_t> _count{0};
+    std::atomic<double> _sum{0.0};
+};
+
+struct MetricsSnapshot
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t uploads = 0;
+    uint64_t bytesUploaded = 0;
+    uint64_t downloads = 0;
+    uint64_t bytesDownloaded = 0;
+    uint64_t submits = 0;
+    uint64_t fenceWaits = 0;
+    uint64_t queueIdleWaits = 0;
+
+    // live device memory per memory type index
+    uint32_t memoryTypeCount = 0;
+    std::array<int64_t, VK_MAX_MEMORY_TYPES> liveBytes{};
+
+    HistogramSnapshot allocationBytes;
+    HistogramSnapshot transferBytes;
+    HistogramSnapshot fenceWaitSeconds;
+    HistogramSnapshot queueIdleWaitSeconds;
+};
+
+// Process wide counters fed by VulkanContext and ComputeBuffer. All updates are relaxed atomics.
+class Metrics : public Singleton<Metrics>
+{
+public:
+    Metrics();
+
+    void recordAllocation(uint32_t memoryType, VkDeviceSize size);
+
+    void recordFree(uint32_t memoryType, VkDeviceSize size);
+
+    void recordUpload(size_t size);
+
+    void recordDownload(size_t size);
+
+    inline void recordSubmit()
+    {
+        _submits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void recordFenceWait(double seconds);
+
+    void recordQueueIdleWait(double seconds);
+
+    MetricsSnapshot snapshot() const;
+
+    // Prometheus text exposition format, metric names are prefixed with vkcompute_
+    static void writePrometheus(std::ostream &out, const MetricsSnapshot &snapshot);
+
+    // written to a temporary file and renamed, so a scraper never sees a partial file
+    void exportPrometheus(const std::string &filename) const;
+
+private:
+    std::atomic<uint64_t> _allocations{0};
+    std::atomic<uint64_t> _frees{0};
+    std::atomic<uint64_t> _uploads{0};
+    std::atomic<uint64_t> _bytesUploaded{0};
+    std::atomic<uint64_t> _downloads{0};
+    std::atomic<uint64_t> _bytesDownloaded{0};
+    std::atomic<uint64_t> _submits{0};
+    std::atomic<uint64_t> _fenceWaits{0};
+    std::atomic<uint64_t> _queueIdleWaits{0};
+    std::array<std::atomic<int64_t>, VK_MAX_MEMORY_TYPES> _liveBytes;
+
+    Histogram _allocationBytes;
+    Histogram _transferBytes;
+    Histogram _fenceWaitSeconds;
+    Histogram _queueIdleWaitSeconds;
+};
+
+#endif
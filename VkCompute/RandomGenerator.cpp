@@ -0,0 +1,205 @@
+#include "RandomGenerator.h"
+#include "ComputeShader.h"
+#include "ComputeBuffer.h"
+#include "ComputeBufferView.h"
+#include "VulkanContext.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#define RANDOM_LOCAL_SIZE 256
+
+namespace
+{
+    enum RandomDistribution
+    {
+        RandomUniform = 0,
+        RandomNormal,
+        RandomInteger
+    };
+
+    // matches the RandomArgs push constant block of Random.comp
+    struct RandomArgs
+    {
+        uint32_t seed[2];
+        uint32_t stream;
+        uint32_t distribution;
+        uint32_t a;
+        uint32_t b;
+        uint32_t position[2];
+        uint32_t count;
+        uint32_t c;
+    };
+
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+}
+
+RandomGenerator::RandomGenerator(uint64_t seed, uint32_t stream, const std::string &shaderDirectory) : _seed(seed), _stream(stream)
+{
+    _shader = new ComputeShader(shaderDirectory + "Random.csv");
+}
+
+void RandomGenerator::setSeed(uint64_t seed, uint32_t stream)
+{
+    _seed = seed;
+    _stream = stream;
+}
+
+void RandomGenerator::uniform(ComputeBuffer *buffer, float low, float high, uint64_t position)
+{
+    if (!(low < high))
+    {
+        throw std::runtime_error("random uniform range is empty!");
+    }
+
+    // the kernel clamps to the float below high, low + u * (high - low) can round up to it
+    fill(buffer, RandomUniform, floatBits(low), floatBits(high), position, floatBits(std::nextafter(high, low)));
+}
+
+void RandomGenerator::normal(ComputeBuffer *buffer, float mean, float deviation, uint64_t position)
+{
+    fill(buffer, RandomNormal, floatBits(mean), floatBits(deviation), position);
+}
+
+void RandomGenerator::integers(ComputeBuffer *buffer, int32_t low, int32_t high, uint64_t position)
+{
+    if (high < low)
+    {
+        throw std::runtime_error("random integer range is empty!");
+    }
+
+    // a range of 2^32 wraps to 0, which the kernel treats as all 32 bits
+    fill(buffer, RandomInteger, (uint32_t)low, (uint32_t)high - (uint32_t)low + 1u, position);
+}
+
+void RandomGenerator::philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+{
+    uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+    uint32_t k[2] = {key[0], key[1]};
+
+    for (int round = 0; round != 10; ++round)
+    {
+        uint64_t p0 = (uint64_t)0xD2511F53u * c[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57u * c[2];
+
+        c[0] = (uint32_t)(p1 >> 32) ^ c[1] ^ k[0];
+        c[1] = (uint32_t)p1;
+        c[2] = (uint32_t)(p0 >> 32) ^ c[3] ^ k[1];
+        c[3] = (uint32_t)p0;
+
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+    }
+
+    memcpy(out, c, sizeof(c));
+}
+
+void RandomGenerator::fill(ComputeBuffer *buffer, uint32_t distribution, uint32_t a, uint32_t b, uint64_t position, uint32_t c)
+{
+    if (buffer->getStride() != 4)
+    {
+        throw std::runtime_error("random fills need 32-bit elements!");
+    }
+
+    if (_commandBuffer == VK_NULL_HANDLE)
+    {
+        _commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(VulkanContext::Instance().device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create random fence!");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(_commandBuffer, 0);
+
+    if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording random command buffer!");
+    }
+
+    // one view per binding range, all in one submission; each dispatch continues the sequence where the
+    // previous one stopped and writes a range of its own, so they need no barrier between them
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    for (const ComputeBufferView &view : ComputeBufferView::split(buffer))
+    {
+        uint64_t start = position + view.getFirst();
+
+        RandomArgs args{};
+        args.seed[0] = (uint32_t)_seed;
+        args.seed[1] = (uint32_t)(_seed >> 32);
+        args.stream = _stream;
+        args.distribution = distribution;
+        args.a = a;
+        args.b = b;
+        args.position[0] = (uint32_t)start;
+        args.position[1] = (uint32_t)(start >> 32);
+        args.count = (uint32_t)view.getCount();
+        args.c = c;
+
+        // four elements per invocation, plus one counter when the start is not a multiple of four
+        uint64_t counters = ((start & 3) + view.getCount() + 3) / 4;
+
+        _shader->setBuffer("RandomOut", view);
+        descriptorSets.push_back(_shader->snapshotDescriptorSet());
+
+        _shader->record(_commandBuffer, (uint32_t)((counters + RANDOM_LOCAL_SIZE - 1) / RANDOM_LOCAL_SIZE), 1, 1, descriptorSets.back(), &args);
+    }
+
+    // host reads and later kernels see the numbers
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    bool recorded = vkEndCommandBuffer(_commandBuffer) == VK_SUCCESS;
+
+    if (recorded)
+    {
+        VulkanContext::Instance().submit(_commandBuffer, _fence);
+        VulkanContext::Instance().waitForFence(_fence);
+        vkResetFences(VulkanContext::Instance().device, 1, &_fence);
+    }
+
+    for (VkDescriptorSet descriptorSet : descriptorSets)
+    {
+        _shader->freeDescriptorSet(descriptorSet);
+    }
+
+    if (!recorded)
+    {
+        throw std::runtime_error("failed to record random command buffer!");
+    }
+}
+
+void RandomGenerator::release()
+{
+    if (_commandBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyFence(VulkanContext::Instance().device, _fence, nullptr);
+        VulkanContext::Instance().freeCommandBuffer(_commandBuffer);
+    }
+
+    _commandBuffer = VK_NULL_HANDLE;
+    _fence = VK_NULL_HANDLE;
+
+    _shader->release();
+    delete _shader;
+}
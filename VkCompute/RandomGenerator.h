@@ -0,0 +1,52 @@
+#ifndef __VE_RANDOM_GENERATOR_H__
+#define __VE_RANDOM_GENERATOR_H__
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <cstdint>
+
+
+class ComputeShader;
+class ComputeBuffer;
+
+// Fills buffers with Philox4x32-10 random numbers on the device, no upload involved. Element j of a fill is
+// a pure function of (seed, stream, position + j), so results repeat across runs, devices and chunkings.
+// Kernels draw from the same sequences through res/shaders/Philox.glsl.
+class RandomGenerator
+{
+public:
+    explicit RandomGenerator(uint64_t seed = 0, uint32_t stream = 0, const std::string &shaderDirectory = "../res/shaders/");
+
+    // independent sequences of one seed differ in stream
+    void setSeed(uint64_t seed, uint32_t stream = 0);
+
+    // the buffers hold 32-bit elements (stride 4); position is the sequence index of element 0,
+    // so consecutive fills of one sequence pass the number of elements already drawn
+
+    // floats in [low, high), low < high
+    void uniform(ComputeBuffer *buffer, float low = 0.0f, float high = 1.0f, uint64_t position = 0);
+
+    // normally distributed floats
+    void normal(ComputeBuffer *buffer, float mean = 0.0f, float deviation = 1.0f, uint64_t position = 0);
+
+    // int32 in [low, high], each value off uniform by at most (high - low + 1) / 2^32
+    void integers(ComputeBuffer *buffer, int32_t low, int32_t high, uint64_t position = 0);
+
+    // host reference of the kernel's generator, counter and key as in Philox.glsl
+    static void philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]);
+
+    void release();
+
+private:
+    ComputeShader *_shader;
+    uint64_t _seed;
+    uint32_t _stream;
+
+    // fills record and wait on their own command buffer, the global one is left to the caller
+    VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+    VkFence _fence = VK_NULL_HANDLE;
+
+    void fill(ComputeBuffer *buffer, uint32_t distribution, uint32_t a, uint32_t b, uint64_t position, uint32_t c = 0);
+};
+
+#endif
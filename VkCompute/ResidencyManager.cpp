@@ -0,0 +1,212 @@
+#include "ResidencyManager.h"
+#include "ComputeBuffer.h"
+#include "VulkanContext.h"
+#include <algorithm>
+
+void ResidencyManager::manage(ComputeBuffer *buffer)
+{
+    if (buffer->getMapped() != nullptr || buffer->isExternal())
+    {
+        return;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    if (_entries.find(buffer) == _entries.end())
+    {
+        _lru.push_front(buffer);
+        _entries[buffer] = _lru.begin();
+    }
+}
+
+void ResidencyManager::unmanage(ComputeBuffer *buffer)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    auto it = _entries.find(buffer);
+
+    if (it != _entries.end())
+    {
+        _lru.erase(it->second);
+        _entries.erase(it);
+    }
+}
+
+void ResidencyManager::setLimit(VkDeviceSize limit)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    _limit = limit;
+
+    VkDeviceSize excess = overBudget(0);
+
+    if (excess != 0)
+    {
+        evict(excess);
+    }
+}
+
+void ResidencyManager::use(const std::vector<ComputeBuffer *> &buffers, bool recorded)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    if (_entries.empty())
+    {
+        return;
+    }
+
+    for (ComputeBuffer *buffer : buffers)
+    {
+        auto it = _entries.find(buffer);
+
+        if (it != _entries.end())
+        {
+            _lru.splice(_lru.begin(), _lru, it->second);
+            _using.insert(buffer);
+        }
+    }
+
+    for (ComputeBuffer *buffer : _using)
+    {
+        if (buffer->isResident())
+        {
+            continue;
+        }
+
+        VkDeviceSize excess = overBudget(buffer->getSize());
+
+        if (excess != 0)
+        {
+            evict(excess);
+        }
+
+        buffer->makeResident();
+        ++_restores;
+    }
+
+    VkDeviceSize excess = overBudget(0);
+
+    if (excess != 0)
+    {
+        evict(excess);
+    }
+
+    if (recorded)
+    {
+        _recorded.insert(_using.begin(), _using.end());
+    }
+
+    _using.clear();
+}
+
+void ResidencyManager::pin(const std::vector<ComputeBuffer *> &buffers)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    use(buffers);
+
+    for (ComputeBuffer *buffer : buffers)
+    {
+        ++_pins[buffer];
+    }
+}
+
+void ResidencyManager::unpin(const std::vector<ComputeBuffer *> &buffers)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    for (ComputeBuffer *buffer : buffers)
+    {
+        auto it = _pins.find(buffer);
+
+        if (it != _pins.end() && --it->second == 0)
+        {
+            _pins.erase(it);
+        }
+    }
+}
+
+bool ResidencyManager::isInUse(ComputeBuffer *buffer)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    return _using.count(buffer) != 0 || _pins.count(buffer) != 0 || _recorded.count(buffer) != 0 || _inFlight.count(buffer) != 0;
+}
+
+void ResidencyManager::submitted()
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    _inFlight.insert(_recorded.begin(), _recorded.end());
+    _recorded.clear();
+}
+
+void ResidencyManager::completed()
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    _inFlight.clear();
+}
+
+VkDeviceSize ResidencyManager::evict(VkDeviceSize size)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    VkDeviceSize freed = 0;
+
+    for (auto it = _lru.rbegin(); it != _lru.rend() && freed < size; ++it)
+    {
+        ComputeBuffer *buffer = *it;
+
+        if (!buffer->isResident() || buffer->hasBindlessIndex() || isInUse(buffer))
+        {
+            continue;
+        }
+
+        buffer->evict();
+        freed += buffer->getSize();
+        ++_evictions;
+    }
+
+    return freed;
+}
+
+VkDeviceSize ResidencyManager::getResidentBytes()
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    VkDeviceSize bytes = 0;
+
+    for (ComputeBuffer *buffer : _lru)
+    {
+        if (buffer->isResident())
+        {
+            bytes += buffer->getSize();
+        }
+    }
+
+    return bytes;
+}
+
+VkDeviceSize ResidencyManager::overBudget(VkDeviceSize incoming)
+{
+    if (_limit != 0)
+    {
+        VkDeviceSize resident = getResidentBytes() + incoming;
+        return resident > _limit ? resident - _limit : 0;
+    }
+
+    VkDeviceSize excess = 0;
+
+    for (const HeapBudget &heap : VulkanContext::Instance().getMemoryBudget())
+    {
+        VkDeviceSize usage = heap.usage + incoming;
+
+        if (heap.deviceLocal && usage > heap.budget)
+        {
+            excess = std::max(excess, usage - heap.budget);
+        }
+    }
+
+    return excess;
+}
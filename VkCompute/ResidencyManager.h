@@ -0,0 +1,82 @@
+#ifndef __VE_RESIDENCY_MANAGER_H__
+#define __VE_RESIDENCY_MANAGER_H__
+
+#include <vulkan/vulkan.h>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+#include "Singleton.h"
+
+
+class ComputeBuffer;
+
+// Keeps managed buffers under a device memory limit by evicting the least recently used ones to host memory.
+// ComputeShader::dispatch pages its bound buffers back in and keeps them resident until its work is done. Descriptor sets,
+// recorded transfers and async reads capture VkBuffer handles, so they pin their buffers until they are freed or complete;
+// buffers in the BindlessHeap are never evicted.
+class ResidencyManager : public Singleton<ResidencyManager>
+{
+public:
+    // mapped, imported and shared buffers cannot be evicted and are ignored
+    void manage(ComputeBuffer *buffer);
+
+    void unmanage(ComputeBuffer *buffer);
+
+    // resident bytes allowed for managed buffers, 0 follows the budget of the device local heaps
+    void setLimit(VkDeviceSize limit);
+
+    // page in and mark as most recently used, evicting other idle buffers to stay under the limit;
+    // recorded = true keeps them from being evicted until the shared VulkanContext command buffer they were
+    // recorded into has been submitted by compute() and has completed
+    void use(const std::vector<ComputeBuffer *> &buffers, bool recorded = false);
+
+    // page in and keep resident until the matching unpin, pins of a buffer are counted
+    void pin(const std::vector<ComputeBuffer *> &buffers);
+
+    void unpin(const std::vector<ComputeBuffer *> &buffers);
+
+    // pinned, recorded or in flight, evicting it would leave a stale VkBuffer behind
+    bool isInUse(ComputeBuffer *buffer);
+
+    // called by VulkanContext: the recorded buffers went out with a submit, and the last submit finished
+    void submitted();
+
+    void completed();
+
+    // evict least recently used buffers not in use until size bytes are freed, returns the bytes freed
+    VkDeviceSize evict(VkDeviceSize size);
+
+    VkDeviceSize getResidentBytes();
+
+    inline uint64_t getEvictions() const
+    {
+        return _evictions;
+    }
+
+    inline uint64_t getRestores() const
+    {
+        return _restores;
+    }
+
+private:
+    // bytes above the limit or the heap budget, 0 when within
+    VkDeviceSize overBudget(VkDeviceSize incoming);
+
+    std::recursive_mutex _mutex;
+    VkDeviceSize _limit = 0;
+
+    // front is the most recently used
+    std::list<ComputeBuffer *> _lru;
+    std::unordered_map<ComputeBuffer *, std::list<ComputeBuffer *>::iterator> _entries;
+    std::unordered_set<ComputeBuffer *> _using;
+    std::unordered_map<ComputeBuffer *, uint32_t> _pins;
+    std::unordered_set<ComputeBuffer *> _recorded;
+    std::unordered_set<ComputeBuffer *> _inFlight;
+
+    uint64_t _evictions = 0;
+    uint64_t _restores = 0;
+};
+
+#endif
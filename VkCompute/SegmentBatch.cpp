@@ -0,0 +1,169 @@
+#include "SegmentBatch.h"
+#include "ComputeBuffer.h"
+#include "VulkanContext.h"
+#include <algorithm>
+
+// grow device buffers geometrically so steady traffic stops reallocating, the old contents are copied over on the device
+static ComputeBuffer* reserveBuffer(ComputeBuffer *buffer, size_t count)
+{
+    count = std::max<size_t>(count, 1);
+
+    if (buffer != nullptr && (size_t)buffer->getCount() >= count)
+    {
+        return buffer;
+    }
+
+    size_t capacity = buffer != nullptr ? (size_t)buffer->getCount() : 256;
+
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+
+    ComputeBuffer *grown = new ComputeBuffer((uint64_t)capacity, 4, Dynamic);
+
+    if (buffer != nullptr)
+    {
+        VulkanContext::Instance().copyBuffer(buffer->getBuffer(), grown->getBuffer(), buffer->getSize());
+        buffer->release();
+        delete buffer;
+    }
+
+    return grown;
+}
+
+// extends the last range when the new one follows it directly
+static void addRange(std::vector<std::pair<uint32_t, uint32_t>> &ranges, uint32_t begin, uint32_t end)
+{
+    if (begin == end)
+    {
+        return;
+    }
+
+    if (!ranges.empty() && ranges.back().second == begin)
+    {
+        ranges.back().second = end;
+    }
+    else
+    {
+        ranges.push_back({begin, end});
+    }
+}
+
+int SegmentBatch::add(const float *data, uint32_t count)
+{
+    uint32_t begin = (uint32_t)_values.size();
+
+    _values.insert(_values.end(), data, data + count);
+    _offsets.push_back((uint32_t)_values.size());
+
+    addRange(_pendingValues, begin, (uint32_t)_values.size());
+    _offsetsDirty = true;
+
+    return (int)_offsets.size() - 2;
+}
+
+int SegmentBatch::reserve(uint32_t count)
+{
+    uint32_t begin = (uint32_t)_values.size();
+
+    _values.resize(_values.size() + count, 0.0f);
+    _offsets.push_back((uint32_t)_values.size());
+
+    addRange(_pendingZeros, begin, (uint32_t)_values.size());
+    _offsetsDirty = true;
+
+    return (int)_offsets.size() - 2;
+}
+
+void SegmentBatch::upload()
+{
+    _valuesBuffer = reserveBuffer(_valuesBuffer, _values.size());
+
+    for (const auto &range : _pendingValues)
+    {
+        _valuesBuffer->setData(_values.data(), range.second - range.first, range.first, range.first);
+    }
+
+    if (!_pendingZeros.empty())
+    {
+        VkBuffer values = _valuesBuffer->getBuffer();
+
+        VulkanContext::Instance().executeOnce([&](VkCommandBuffer cmd)
+        {
+            // kernels of an earlier batch may still be writing the same range
+            VkMemoryBarrier before{};
+            before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            before.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            before.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &before, 0, nullptr, 0, nullptr);
+
+            for (const auto &range : _pendingZeros)
+            {
+                vkCmdFillBuffer(cmd, values, (VkDeviceSize)range.first * sizeof(float), (VkDeviceSize)(range.second - range.first) * sizeof(float), 0);
+            }
+
+            VkMemoryBarrier after{};
+            after.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            after.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            after.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 1, &after, 0, nullptr, 0, nullptr);
+        });
+    }
+
+    if (_offsetsDirty)
+    {
+        _offsetsBuffer = reserveBuffer(_offsetsBuffer, _offsets.size());
+        _offsetsBuffer->setData(_offsets.data(), (uint64_t)_offsets.size());
+    }
+
+    _pendingValues.clear();
+    _pendingZeros.clear();
+    _offsetsDirty = false;
+}
+
+void SegmentBatch::download()
+{
+    if (_valuesBuffer != nullptr && !_values.empty())
+    {
+        _valuesBuffer->getData(_values.data(), (uint64_t)_values.size());
+    }
+}
+
+std::vector<float> SegmentBatch::get(int segment) const
+{
+    return std::vector<float>(_values.begin() + _offsets[segment], _values.begin() + _offsets[segment + 1]);
+}
+
+void SegmentBatch::clear()
+{
+    _values.clear();
+    _offsets.assign(1, 0);
+
+    _pendingValues.clear();
+    _pendingZeros.clear();
+    _offsetsDirty = true;
+}
+
+void SegmentBatch::release()
+{
+    clear();
+
+    if (_valuesBuffer != nullptr)
+    {
+        _valuesBuffer->release();
+        delete _valuesBuffer;
+        _valuesBuffer = nullptr;
+    }
+
+    if (_offsetsBuffer != nullptr)
+    {
+        _offsetsBuffer->release();
+        delete _offsetsBuffer;
+        _offsetsBuffer = nullptr;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef __VE_SEGMENT_BATCH_H__
+#define __VE_SEGMENT_BATCH_H__
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+
+class ComputeBuffer;
+
+// Many variable length float arrays packed back to back into one buffer, with an offsets table of
+// segmentCount + 1 uints so a batched kernel finds segment s at [offsets[s], offsets[s + 1]).
+// One SegmentBatch replaces a ComputeBuffer, setBuffer and dispatch per small problem, see BatchKernels.
+class SegmentBatch
+{
+public:
+    // returns the segment index, empty segments are allowed
+    int add(const float *data, uint32_t count);
+
+    inline int add(const std::vector<float> &data)
+    {
+        return add(data.data(), (uint32_t)data.size());
+    }
+
+    // zero filled segment for kernel output, upload() clears it with a device fill instead of copying zeros
+    int reserve(uint32_t count);
+
+    // copy what changed since the last upload to the device, growing the buffers when needed;
+    // a grown buffer keeps the device contents of the old one, so results not downloaded yet survive
+    void upload();
+
+    // read the values written by a kernel back into the host copy
+    void download();
+
+    inline const float* data(int segment) const
+    {
+        return _values.data() + _offsets[segment];
+    }
+
+    std::vector<float> get(int segment) const;
+
+    inline uint32_t getCount(int segment) const
+    {
+        return _offsets[segment + 1] - _offsets[segment];
+    }
+
+    inline uint32_t getSegmentCount() const
+    {
+        return (uint32_t)_offsets.size() - 1;
+    }
+
+    inline uint32_t getTotalCount() const
+    {
+        return _offsets.back();
+    }
+
+    // valid after upload()
+    inline ComputeBuffer* getValues() const
+    {
+        return _valuesBuffer;
+    }
+
+    inline ComputeBuffer* getOffsets() const
+    {
+        return _offsetsBuffer;
+    }
+
+    // drop all segments, the device buffers are kept for the next batch
+    void clear();
+
+    void release();
+
+private:
+    std::vector<float> _values;
+    std::vector<uint32_t> _offsets{0};
+
+    // [begin, end) value ranges added or reserved since the last upload
+    std::vector<std::pair<uint32_t, uint32_t>> _pendingValues;
+    std::vector<std::pair<uint32_t, uint32_t>> _pendingZeros;
+    bool _offsetsDirty = true;
+
+    ComputeBuffer *_valuesBuffer = nullptr;
+    ComputeBuffer *_offsetsBuffer = nullptr;
+};
+
+#endif
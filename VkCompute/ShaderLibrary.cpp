@@ -0,0 +1,124 @@
+#include "ShaderLibrary.h"
+#include "ComputeShader.h"
+#include <filesystem>
+#include <stdexcept>
+
+ShaderLibrary::ShaderLibrary(const std::string &directory, bool lazy, unsigned threads) : _pool(threads)
+{
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error);
+
+    if (error)
+    {
+        throw std::runtime_error("failed to open shader directory: " + directory);
+    }
+
+    for (const auto &entry : it)
+    {
+        const std::filesystem::path &path = entry.path();
+
+        if (path.extension() != ".csv")
+        {
+            continue;
+        }
+
+        std::filesystem::path spirv = path;
+        spirv.replace_extension(".spv");
+
+        std::string filename = path.string();
+
+        // a shader without SPIR-V stays listed, get() and wait() report it like any other failed load
+        if (!std::filesystem::exists(spirv))
+        {
+            std::promise<ComputeShader *> missing;
+            missing.set_exception(std::make_exception_ptr(std::runtime_error("missing SPIR-V for shader: " + path.stem().string())));
+            _shaders[path.stem().string()] = missing.get_future().share();
+            continue;
+        }
+
+        _shaders[path.stem().string()] = _pool.submit([filename, lazy]
+        {
+            return new ComputeShader(filename, "main", lazy);
+        }).share();
+    }
+}
+
+ComputeShader *ShaderLibrary::get(const std::string &name)
+{
+    auto it = _shaders.find(name);
+
+    if (it == _shaders.end())
+    {
+        throw std::runtime_error("failed to find shader: " + name);
+    }
+
+    return it->second.get();
+}
+
+std::vector<std::string> ShaderLibrary::names() const
+{
+    std::vector<std::string> result;
+
+    for (const auto &it : _shaders)
+    {
+        result.push_back(it.first);
+    }
+
+    return result;
+}
+
+void ShaderLibrary::prewarm()
+{
+    for (const auto &it : _shaders)
+    {
+        std::shared_future<ComputeShader *> shader = it.second;
+
+        _prewarm.push_back(_pool.submit([shader]
+        {
+            shader.get()->compile();
+        }));
+    }
+}
+
+void ShaderLibrary::wait()
+{
+    for (const auto &it : _shaders)
+    {
+        it.second.get();
+    }
+
+    for (auto &future : _prewarm)
+    {
+        future.get();
+    }
+
+    _prewarm.clear();
+}
+
+void ShaderLibrary::release()
+{
+    for (auto &future : _prewarm)
+    {
+        future.wait();
+    }
+
+    _prewarm.clear();
+
+    for (const auto &it : _shaders)
+    {
+        it.second.wait();
+
+        try
+        {
+            ComputeShader *shader = it.second.get();
+            shader->release();
+            delete shader;
+        }
+        catch (const std::exception &)
+        {
+            // failed loads have nothing to release
+        }
+    }
+
+    _shaders.clear();
+}
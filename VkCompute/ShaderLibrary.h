@@ -0,0 +1,40 @@
+#ifndef __VE_SHADER_LIBRARY_H__
+#define __VE_SHADER_LIBRARY_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <future>
+#include "ThreadPool.h"
+
+
+class ComputeShader;
+
+// Loads every <name>.csv/<name>.spv pair of a directory on a worker pool; a .csv without its .spv fails to load.
+// Eager mode creates all pipelines concurrently; lazy mode only loads SPIR-V and bindings and
+// compiles a pipeline on its first dispatch, or ahead of time with prewarm().
+class ShaderLibrary
+{
+public:
+    ShaderLibrary(const std::string &directory, bool lazy = false, unsigned threads = 0);
+
+    // shader by file name without extension, e.g. "ComputeShader"; waits for it to be loaded, rethrows its failure
+    ComputeShader *get(const std::string &name);
+
+    std::vector<std::string> names() const;
+
+    // compile the remaining lazy pipelines in the background, returns immediately
+    void prewarm();
+
+    // block until loading and prewarming have finished, rethrows the first failure
+    void wait();
+
+    void release();
+
+private:
+    ThreadPool _pool;
+    std::map<std::string, std::shared_future<ComputeShader *>> _shaders;
+    std::vector<std::future<void>> _prewarm;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "SharedFence.h"
+#include "VulkanContext.h"
+#include <stdexcept>
+
+SharedFence::SharedFence()
+{
+    create(VK_EXTERNAL_FENCE_FEATURE_EXPORTABLE_BIT);
+}
+
+SharedFence::SharedFence(int fd)
+{
+    create(VK_EXTERNAL_FENCE_FEATURE_IMPORTABLE_BIT);
+
+    VkDevice device = VulkanContext::Instance().device;
+    auto importFenceFd = (PFN_vkImportFenceFdKHR)vkGetDeviceProcAddr(device, "vkImportFenceFdKHR");
+
+    VkImportFenceFdInfoKHR importInfo{};
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_FENCE_FD_INFO_KHR;
+    importInfo.fence = _fence;
+    importInfo.handleType = VK_EXTERNAL_FENCE_HANDLE_TYPE_OPAQUE_FD_BIT;
+    importInfo.fd = fd;
+
+    if (importFenceFd == nullptr || importFenceFd(device, &importInfo) != VK_SUCCESS)
+    {
+        release();
+        throw std::runtime_error("failed to import fence!");
+    }
+}
+
+void SharedFence::create(VkExternalFenceFeatureFlags features)
+{
+    if (!VulkanContext::Instance().isExtensionEnabled(VK_KHR_EXTERNAL_FENCE_FD_EXTENSION_NAME))
+    {
+        throw std::runtime_error("shared fences need VK_KHR_external_fence_fd!");
+    }
+
+    VkPhysicalDeviceExternalFenceInfo externalFenceInfo{};
+    externalFenceInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_FENCE_INFO;
+    externalFenceInfo.handleType = VK_EXTERNAL_FENCE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+    VkExternalFenceProperties externalProperties{};
+    externalProperties.sType = VK_STRUCTURE_TYPE_EXTERNAL_FENCE_PROPERTIES;
+
+    vkGetPhysicalDeviceExternalFenceProperties(VulkanContext::Instance().getPhysicalDevice(), &externalFenceInfo, &externalProperties);
+
+    if ((externalProperties.externalFenceFeatures & features) != features)
+    {
+        throw std::runtime_error("device cannot share fences through file descriptors!");
+    }
+
+    VkExportFenceCreateInfo exportInfo{};
+    exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_FENCE_CREATE_INFO;
+    exportInfo.handleTypes = VK_EXTERNAL_FENCE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.pNext = &exportInfo;
+
+    if (vkCreateFence(VulkanContext::Instance().device, &fenceInfo, nullptr, &_fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shared fence!");
+    }
+}
+
+int SharedFence::exportFd()
+{
+    VkDevice device = VulkanContext::Instance().device;
+    auto getFenceFd = (PFN_vkGetFenceFdKHR)vkGetDeviceProcAddr(device, "vkGetFenceFdKHR");
+
+    VkFenceGetFdInfoKHR getFdInfo{};
+    getFdInfo.sType = VK_STRUCTURE_TYPE_FENCE_GET_FD_INFO_KHR;
+    getFdInfo.fence = _fence;
+    getFdInfo.handleType = VK_EXTERNAL_FENCE_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+    int fd = -1;
+
+    if (getFenceFd == nullptr || getFenceFd(device, &getFdInfo, &fd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to export fence!");
+    }
+
+    return fd;
+}
+
+void SharedFence::signal()
+{
+    VulkanContext::Instance().signalFence(_fence);
+}
+
+void SharedFence::wait()
+{
+    VulkanContext::Instance().waitForFence(_fence);
+}
+
+bool SharedFence::isSignaled()
+{
+    return vkGetFenceStatus(VulkanContext::Instance().device, _fence) == VK_SUCCESS;
+}
+
+void SharedFence::reset()
+{
+    vkResetFences(VulkanContext::Instance().device, 1, &_fence);
+}
+
+void SharedFence::release()
+{
+    vkDestroyFence(VulkanContext::Instance().device, _fence, nullptr);
+    _fence = VK_NULL_HANDLE;
+}
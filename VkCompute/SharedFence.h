@@ -0,0 +1,45 @@
+#ifndef __VE_SHARED_FENCE_H__
+#define __VE_SHARED_FENCE_H__
+
+#include <vulkan/vulkan.h>
+
+
+// A fence whose payload is shared with another process through a file descriptor (VK_KHR_external_fence_fd),
+// used to hand off buffers shared with ComputeBuffer::exportFd: the producer signals after its work,
+// the consumer waits before reading and resets before the producer signals again.
+class SharedFence
+{
+public:
+    // exportable fence, unsignalled
+    SharedFence();
+
+    // import a descriptor from exportFd(), owned by the driver afterwards
+    explicit SharedFence(int fd);
+
+    // new descriptor for the fence, the caller closes it
+    int exportFd();
+
+    // signals once all work submitted to the compute queue so far has finished
+    void signal();
+
+    void wait();
+
+    bool isSignaled();
+
+    void reset();
+
+    inline VkFence getFence() const
+    {
+        return _fence;
+    }
+
+    void release();
+
+private:
+    VkFence _fence = VK_NULL_HANDLE;
+
+    // throws unless the device supports the export or import features an opaque fd fence needs here
+    void create(VkExternalFenceFeatureFlags features);
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef __VE_STD430_H__
+#define __VE_STD430_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+
+
+// Host mirrors of GLSL types whose C++ alignment equals their std430 base alignment, so a
+// struct built from them gets the same member offsets and array stride as the shader.
+// std430 lets a scalar follow a vec3 inside its 16 byte slot; these vec3 types cannot, so
+// put the scalar in vec3::w style padding yourself or use a vec4.
+namespace std430
+{
+    struct alignas(8) vec2 { float x, y; };
+    struct alignas(16) vec3 { float x, y, z; };
+    struct alignas(16) vec4 { float x, y, z, w; };
+
+    struct alignas(8) ivec2 { int32_t x, y; };
+    struct alignas(16) ivec3 { int32_t x, y, z; };
+    struct alignas(16) ivec4 { int32_t x, y, z, w; };
+
+    struct alignas(8) uvec2 { uint32_t x, y; };
+    struct alignas(16) uvec3 { uint32_t x, y, z; };
+    struct alignas(16) uvec4 { uint32_t x, y, z, w; };
+
+    struct alignas(16) mat4 { vec4 columns[4]; };
+
+    // base alignment and size of T in a std430 block; alignment 0 means T has no std430 equivalent
+    template <typename T, typename Enable = void>
+    struct Layout
+    {
+        static constexpr size_t alignment = 0;
+        static constexpr size_t size = 0;
+    };
+
+    template <typename T>
+    struct Layout<T, typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, int32_t>::value || std::is_same<T, uint32_t>::value ||
+                                             std::is_same<T, double>::value || std::is_same<T, int64_t>::value || std::is_same<T, uint64_t>::value>::type>
+    {
+        static constexpr size_t alignment = sizeof(T);
+        static constexpr size_t size = sizeof(T);
+    };
+
+    template <size_t Alignment, size_t Size>
+    struct Vector
+    {
+        static constexpr size_t alignment = Alignment;
+        static constexpr size_t size = Size;
+    };
+
+    template <> struct Layout<vec2> : Vector<8, 8> {};
+    template <> struct Layout<vec3> : Vector<16, 12> {};
+    template <> struct Layout<vec4> : Vector<16, 16> {};
+    template <> struct Layout<ivec2> : Vector<8, 8> {};
+    template <> struct Layout<ivec3> : Vector<16, 12> {};
+    template <> struct Layout<ivec4> : Vector<16, 16> {};
+    template <> struct Layout<uvec2> : Vector<8, 8> {};
+    template <> struct Layout<uvec3> : Vector<16, 12> {};
+    template <> struct Layout<uvec4> : Vector<16, 16> {};
+    template <> struct Layout<mat4> : Vector<16, 64> {};
+
+    constexpr size_t alignUp(size_t value, size_t alignment)
+    {
+        return alignment != 0 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    // std430 layout of a struct with the given member types in declaration order; the C++ struct must come out
+    // the same size, which fails for members without a std430 equivalent and for scalars packed behind a vec3
+    template <typename T, typename... Members>
+    struct Struct
+    {
+        static_assert(sizeof...(Members) > 0, "a std430 struct needs members");
+        static_assert(((Layout<Members>::alignment != 0) && ...), "struct member has no std430 equivalent (bool, char, short and raw arrays are not allowed)");
+
+        static constexpr size_t alignment = std::max({Layout<Members>::alignment...});
+
+        static constexpr size_t end()
+        {
+            size_t offset = 0;
+            ((offset = alignUp(offset, Layout<Members>::alignment) + Layout<Members>::size), ...);
+            return offset;
+        }
+
+        // rounded up to the struct's own alignment (std430 rule 9), so nested structs and struct arrays step correctly
+        static constexpr size_t size = alignUp(end(), alignment);
+
+        static_assert(sizeof(T) == size, "struct does not match the std430 layout of its members");
+    };
+
+    // bytes between consecutive elements of a T[] in a std430 block
+    template <typename T>
+    constexpr size_t stride()
+    {
+        return Layout<T>::alignment != 0 ? alignUp(Layout<T>::size, Layout<T>::alignment) : 0;
+    }
+}
+
+// describe a buffer element struct by its member types, e.g. STD430_STRUCT(Particle, std430::vec4, float, float);
+// TypedComputeBuffer only accepts scalars, the vector types above and structs described this way
+#define STD430_STRUCT(Type, ...) \
+    template <> struct std430::Layout<Type> : std430::Struct<Type, __VA_ARGS__> {}
+
+// pin a member to the offset the shader reports, e.g. STD430_OFFSET(Particle, velocity, 16);
+#define STD430_OFFSET(Type, member, offset) \
+    static_assert(offsetof(Type, member) == (offset), #Type "::" #member " does not match its std430 offset")
+
+#endif
@@ -0,0 +1,355 @@
+#include "StreamExecutor.h"
+#include "VulkanContext.h"
+#include "ComputeBuffer.h"
+#include "ComputeShader.h"
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#define CALIBRATE_REPEATS 4
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double gbps(uint64_t bytes, double seconds)
+{
+    return seconds > 0.0 ? (double)bytes / seconds / 1e9 : 0.0;
+}
+
+void StreamStats::report(std::ostream &out) const
+{
+    double upload = gbps(bytesUploaded, seconds);
+    double download = gbps(bytesDownloaded, seconds);
+
+    out << "stream: " << chunks << " chunks, " << bytesUploaded / (1024 * 1024) << " MB up, "
+        << bytesDownloaded / (1024 * 1024) << " MB down in " << seconds << " s" << std::endl;
+
+    out << "  upload   " << upload << " GB/s";
+    if (uploadPeakGBps > 0.0)
+    {
+        out << " (" << 100.0 * upload / uploadPeakGBps << "% of " << uploadPeakGBps << " GB/s transfer peak)";
+    }
+    out << std::endl;
+
+    out << "  download " << download << " GB/s";
+    if (downloadPeakGBps > 0.0)
+    {
+        out << " (" << 100.0 * download / downloadPeakGBps << "% of " << downloadPeakGBps << " GB/s transfer peak)";
+    }
+    out << std::endl;
+
+    out << "  host: produce " << produceSeconds << " s, consume " << consumeSeconds << " s, fence wait " << waitSeconds << " s";
+    if (hostCopyGBps > 0.0)
+    {
+        out << " (host memcpy peak " << hostCopyGBps << " GB/s)";
+    }
+    out << std::endl;
+}
+
+StreamExecutor::StreamExecutor(ComputeShader *shader, const std::string &input, const std::string &output,
+                               int chunkCount, int inputStride, int outputStride, int depth, int localSizeX)
+    : _shader(shader), _chunkCount(chunkCount), _inputStride(inputStride), _outputStride(outputStride), _depth(depth), _localSizeX(localSizeX)
+{
+    if (depth < 2 || depth > 3)
+    {
+        throw std::runtime_error("stream depth must be 2 or 3!");
+    }
+
+    // the last workgroup of a chunk would otherwise write past the end of the device buffer
+    if (localSizeX <= 0 || chunkCount <= 0 || chunkCount % localSizeX != 0)
+    {
+        throw std::runtime_error("stream chunk count must be a multiple of the workgroup size!");
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    try
+    {
+        for (int i = 0; i != 2; ++i)
+        {
+            _deviceIn[i] = new ComputeBuffer(chunkCount, inputStride, DeviceLocal);
+            _deviceOut[i] = new ComputeBuffer(chunkCount, outputStride, DeviceLocal);
+            _descriptorSets[i] = shader->allocateDescriptorSet({{input, _deviceIn[i]}, {output, _deviceOut[i]}});
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        _slots.resize(depth);
+
+        for (auto &slot : _slots)
+        {
+            slot.stagingIn = new ComputeBuffer(chunkCount, inputStride, Staging);
+            slot.stagingOut = new ComputeBuffer(chunkCount, outputStride, Readback);
+            slot.commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+            if (vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create stream fence!");
+            }
+        }
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+double StreamExecutor::timeCopy(ComputeBuffer *src, ComputeBuffer *dst, VkDeviceSize size)
+{
+    VkDevice device = VulkanContext::Instance().device;
+    Slot &slot = _slots[0];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkBufferCopy region{};
+    region.size = size;
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkResetCommandBuffer(slot.commandBuffer, 0);
+    vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+
+    for (int i = 0; i != CALIBRATE_REPEATS; ++i)
+    {
+        vkCmdCopyBuffer(slot.commandBuffer, src->getBuffer(), dst->getBuffer(), 1, &region);
+        vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    vkEndCommandBuffer(slot.commandBuffer);
+
+    auto start = Clock::now();
+    VulkanContext::Instance().submit(slot.commandBuffer, slot.fence);
+    VulkanContext::Instance().waitForFence(slot.fence);
+    double seconds = secondsSince(start);
+    vkResetFences(device, 1, &slot.fence);
+
+    return gbps(size * CALIBRATE_REPEATS, seconds);
+}
+
+void StreamExecutor::calibrate()
+{
+    Slot &slot = _slots[0];
+
+    _calibration.uploadPeakGBps = timeCopy(slot.stagingIn, _deviceIn[0], slot.stagingIn->getSize());
+    _calibration.downloadPeakGBps = timeCopy(_deviceOut[0], slot.stagingOut, slot.stagingOut->getSize());
+
+    size_t bytes = (size_t)_chunkCount * _inputStride;
+    std::vector<char> src(bytes, 1), dst(bytes);
+
+    auto start = Clock::now();
+    for (int i = 0; i != CALIBRATE_REPEATS; ++i)
+    {
+        memcpy(dst.data(), src.data(), bytes);
+    }
+    _calibration.hostCopyGBps = gbps((uint64_t)bytes * CALIBRATE_REPEATS, secondsSince(start));
+}
+
+void StreamExecutor::waitSlot(Slot &slot, size_t count, const Consumer &consumer, StreamStats &stats)
+{
+    if (!slot.pending)
+    {
+        return;
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+
+    auto start = Clock::now();
+    VulkanContext::Instance().waitForFence(slot.fence);
+    vkResetFences(device, 1, &slot.fence);
+    stats.waitSeconds += secondsSince(start);
+
+    slot.pending = false;
+
+    if (slot.downloadChunk >= 0)
+    {
+        size_t first = (size_t)slot.downloadChunk * _chunkCount;
+        size_t n = std::min((size_t)_chunkCount, count - first);
+
+        // chunk c was downloaded by step c + 2 into the staging of slot c % depth
+        const Slot &owner = _slots[slot.downloadChunk % _depth];
+
+        start = Clock::now();
+        consumer(owner.stagingOut->getMapped(), first, n);
+        stats.consumeSeconds += secondsSince(start);
+        stats.bytesDownloaded += (uint64_t)n * _outputStride;
+
+        slot.downloadChunk = -1;
+    }
+}
+
+void StreamExecutor::recordStep(Slot &slot, size_t step, size_t chunks, size_t count)
+{
+    auto chunkSize = [&](size_t chunk) { return std::min((size_t)_chunkCount, count - chunk * _chunkCount); };
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(slot.commandBuffer, 0);
+
+    if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording stream command buffer!");
+    }
+
+    // upload, compute and download of neighbouring chunks touch disjoint buffers, so no barrier between them
+    if (step < chunks)
+    {
+        VkBufferCopy region{};
+        region.size = (VkDeviceSize)chunkSize(step) * _inputStride;
+        vkCmdCopyBuffer(slot.commandBuffer, slot.stagingIn->getBuffer(), _deviceIn[step % 2]->getBuffer(), 1, &region);
+    }
+
+    if (step >= 1 && step - 1 < chunks)
+    {
+        size_t chunk = step - 1;
+        uint32_t groups = (uint32_t)((chunkSize(chunk) + _localSizeX - 1) / _localSizeX);
+        _shader->record(slot.commandBuffer, groups, 1, 1, _descriptorSets[chunk % 2]);
+    }
+
+    if (step >= 2 && step - 2 < chunks)
+    {
+        size_t chunk = step - 2;
+        VkBufferCopy region{};
+        region.size = (VkDeviceSize)chunkSize(chunk) * _outputStride;
+        vkCmdCopyBuffer(slot.commandBuffer, _deviceOut[chunk % 2]->getBuffer(), _slots[chunk % _depth].stagingOut->getBuffer(), 1, &region);
+        slot.downloadChunk = (int64_t)chunk;
+    }
+
+    // the next step reuses the device buffers this one wrote or read
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(slot.commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record stream command buffer!");
+    }
+}
+
+StreamStats StreamExecutor::run(size_t count, const Producer &producer, const Consumer &consumer)
+{
+    StreamStats stats = _calibration;
+    size_t chunks = (count + _chunkCount - 1) / _chunkCount;
+    size_t steps = chunks + 2;
+
+    stats.chunks = chunks;
+
+    auto start = Clock::now();
+
+    for (size_t step = 0; step != steps; ++step)
+    {
+        Slot &slot = _slots[step % _depth];
+
+        // frees this slot's staging for chunk `step` and hands chunk `step - depth - 2` to the consumer
+        waitSlot(slot, count, consumer, stats);
+
+        if (step < chunks)
+        {
+            size_t first = step * _chunkCount;
+            size_t n = std::min((size_t)_chunkCount, count - first);
+
+            auto produceStart = Clock::now();
+            producer(slot.stagingIn->getMapped(), first, n);
+            stats.produceSeconds += secondsSince(produceStart);
+            stats.bytesUploaded += (uint64_t)n * _inputStride;
+        }
+
+        recordStep(slot, step, chunks, count);
+
+        VulkanContext::Instance().submit(slot.commandBuffer, slot.fence);
+        slot.pending = true;
+    }
+
+    for (size_t step = steps > (size_t)_depth ? steps - _depth : 0; step != steps; ++step)
+    {
+        waitSlot(_slots[step % _depth], count, consumer, stats);
+    }
+
+    stats.seconds = secondsSince(start);
+
+    return stats;
+}
+
+StreamStats StreamExecutor::run(const void *src, void *dst, size_t count)
+{
+    const char *in = (const char *)src;
+    char *out = (char *)dst;
+
+    return run(
+        count,
+        [&](void *staging, size_t first, size_t n) { memcpy(staging, in + first * _inputStride, n * _inputStride); },
+        [&](const void *staging, size_t first, size_t n) { memcpy(out + first * _outputStride, staging, n * _outputStride); });
+}
+
+void StreamExecutor::release()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    for (auto &slot : _slots)
+    {
+        if (slot.pending)
+        {
+            VulkanContext::Instance().waitForFence(slot.fence);
+        }
+
+        if (slot.fence != VK_NULL_HANDLE)
+        {
+            vkDestroyFence(device, slot.fence, nullptr);
+        }
+
+        if (slot.commandBuffer != VK_NULL_HANDLE)
+        {
+            VulkanContext::Instance().freeCommandBuffer(slot.commandBuffer);
+        }
+
+        for (ComputeBuffer *staging : {slot.stagingIn, slot.stagingOut})
+        {
+            if (staging != nullptr)
+            {
+                staging->release();
+                delete staging;
+            }
+        }
+    }
+
+    _slots.clear();
+
+    for (int i = 0; i != 2; ++i)
+    {
+        if (_descriptorSets[i] != VK_NULL_HANDLE)
+        {
+            _shader->freeDescriptorSet(_descriptorSets[i]);
+            _descriptorSets[i] = VK_NULL_HANDLE;
+        }
+
+        for (ComputeBuffer *buffer : {_deviceIn[i], _deviceOut[i]})
+        {
+            if (buffer != nullptr)
+            {
+                buffer->release();
+                delete buffer;
+            }
+        }
+
+        _deviceIn[i] = nullptr;
+        _deviceOut[i] = nullptr;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef __VE_STREAM_EXECUTOR_H__
+#define __VE_STREAM_EXECUTOR_H__
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+
+
+class ComputeShader;
+class ComputeBuffer;
+
+struct StreamStats
+{
+    size_t chunks = 0;
+    uint64_t bytesUploaded = 0;
+    uint64_t bytesDownloaded = 0;
+
+    double seconds = 0.0;        // wall time of the whole run
+    double produceSeconds = 0.0; // host time spent filling staging memory
+    double consumeSeconds = 0.0; // host time spent draining staging memory
+    double waitSeconds = 0.0;    // host time blocked on fences
+
+    // reference limits measured by StreamExecutor::calibrate(), zero when not calibrated
+    double uploadPeakGBps = 0.0;
+    double downloadPeakGBps = 0.0;
+    double hostCopyGBps = 0.0;
+
+    void report(std::ostream &out) const;
+};
+
+// Runs a kernel over an input that does not fit in device memory, one chunk at a time.
+// Every submitted step uploads chunk i+1, computes chunk i and downloads chunk i-1 without
+// barriers between the three, while the host fills and drains staging buffers of the
+// other in-flight steps (depth 2 = double, 3 = triple buffering).
+class StreamExecutor
+{
+public:
+    typedef std::function<void(void *staging, size_t first, size_t count)> Producer;
+    typedef std::function<void(const void *staging, size_t first, size_t count)> Consumer;
+
+    // chunkCount must be a multiple of localSizeX, the kernel is dispatched in whole workgroups per chunk
+    StreamExecutor(ComputeShader *shader, const std::string &input, const std::string &output,
+                   int chunkCount, int inputStride, int outputStride, int depth = 3, int localSizeX = 256);
+
+    // measure transfer and host copy bandwidth so run() can report how close it gets
+    void calibrate();
+
+    StreamStats run(size_t count, const Producer &producer, const Consumer &consumer);
+
+    StreamStats run(const void *src, void *dst, size_t count);
+
+    void release();
+
+private:
+    struct Slot
+    {
+        ComputeBuffer *stagingIn = nullptr;
+        ComputeBuffer *stagingOut = nullptr;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        bool pending = false;
+        int64_t downloadChunk = -1;
+    };
+
+    ComputeShader *_shader;
+    int _chunkCount;
+    int _inputStride;
+    int _outputStride;
+    int _depth;
+    int _localSizeX;
+
+    std::vector<Slot> _slots;
+    ComputeBuffer *_deviceIn[2] = {nullptr, nullptr};
+    ComputeBuffer *_deviceOut[2] = {nullptr, nullptr};
+    VkDescriptorSet _descriptorSets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+
+    StreamStats _calibration;
+
+    void waitSlot(Slot &slot, size_t count, const Consumer &consumer, StreamStats &stats);
+
+    void recordStep(Slot &slot, size_t step, size_t chunks, size_t count);
+
+    double timeCopy(ComputeBuffer *src, ComputeBuffer *dst, VkDeviceSize size);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "TaskGraph.h"
+#include "ComputeShader.h"
+#include "ComputeBuffer.h"
+#include <algorithm>
+#include <set>
+
+int TaskGraph::add(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ)
+{
+    if (_compiled)
+    {
+        // a new graph reuses the program; its previous descriptor sets are freed by begin()
+        _tasks.clear();
+        _states.clear();
+        _compiled = false;
+    }
+
+    int index = (int)_tasks.size();
+
+    Task task;
+    task.shader = shader;
+    task.groups[0] = threadGroupsX;
+    task.groups[1] = threadGroupsY;
+    task.groups[2] = threadGroupsZ;
+    task.descriptorSet = shader->snapshotDescriptorSet();
+    task.pushConstants = shader->getPushConstants();
+    task.accesses = shader->getBufferAccesses();
+    task.level = 0;
+
+    // a buffer bound twice counts once with the union of its accesses
+    std::map<ComputeBuffer *, std::pair<bool, bool>> uses;
+
+    for (const auto &access : task.accesses)
+    {
+        uses[access.first].first |= access.second != WriteOnly;
+        uses[access.first].second |= access.second != ReadOnly;
+    }
+
+    for (const auto &use : uses)
+    {
+        BufferState &state = _states[use.first];
+        bool reads = use.second.first;
+        bool writes = use.second.second;
+
+        // RAW and WAW on the last writer
+        if (state.lastWriter >= 0)
+        {
+            addDependency(task, state.lastWriter);
+        }
+
+        if (writes)
+        {
+            // WAR on every reader since that write
+            for (int reader : state.readers)
+            {
+                addDependency(task, reader);
+            }
+
+            state.readers.clear();
+            state.lastWriter = index;
+        }
+        else if (reads)
+        {
+            state.readers.push_back(index);
+        }
+    }
+
+    for (int dependency : task.dependencies)
+    {
+        task.level = std::max(task.level, _tasks[dependency].level + 1);
+    }
+
+    _tasks.push_back(task);
+
+    return index;
+}
+
+void TaskGraph::addDependency(Task &task, int other)
+{
+    if (std::find(task.dependencies.begin(), task.dependencies.end(), other) == task.dependencies.end())
+    {
+        task.dependencies.push_back(other);
+    }
+}
+
+void TaskGraph::compile()
+{
+    _levelCount = 0;
+    _barrierCount = 0;
+
+    for (const auto &task : _tasks)
+    {
+        _levelCount = std::max(_levelCount, task.level + 1);
+    }
+
+    std::vector<std::vector<int>> levels(_levelCount);
+
+    for (int i = 0; i != (int)_tasks.size(); ++i)
+    {
+        levels[_tasks[i].level].push_back(i);
+    }
+
+    _program.begin();
+
+    // buffers written by recorded levels and not yet covered by a barrier
+    std::set<ComputeBuffer *> unflushed;
+
+    for (int level = 0; level != _levelCount; ++level)
+    {
+        if (level > 0)
+        {
+            std::set<ComputeBuffer *> flush;
+
+            for (int i : levels[level])
+            {
+                for (const auto &access : _tasks[i].accesses)
+                {
+                    if (unflushed.count(access.first) != 0)
+                    {
+                        flush.insert(access.first);
+                    }
+                }
+            }
+
+            for (ComputeBuffer *buffer : flush)
+            {
+                unflushed.erase(buffer);
+            }
+
+            // a level only exists because of a dependency, a pure WAR needs execution order but no memory barrier
+            _program.barrier(std::vector<ComputeBuffer *>(flush.begin(), flush.end()));
+            _barrierCount++;
+        }
+
+        for (int i : levels[level])
+        {
+            Task &task = _tasks[i];
+
+            _program.dispatch(task.shader, task.groups[0], task.groups[1], task.groups[2], task.descriptorSet, task.pushConstants);
+            task.descriptorSet = VK_NULL_HANDLE;
+
+            for (const auto &access : task.accesses)
+            {
+                if (access.second != ReadOnly)
+                {
+                    unflushed.insert(access.first);
+                }
+            }
+        }
+    }
+
+    _program.end();
+    _compiled = true;
+}
+
+void TaskGraph::submit()
+{
+    if (!_compiled)
+    {
+        compile();
+    }
+
+    _program.submit();
+}
+
+void TaskGraph::wait()
+{
+    _program.wait();
+}
+
+void TaskGraph::release()
+{
+    for (const auto &task : _tasks)
+    {
+        if (task.descriptorSet != VK_NULL_HANDLE)
+        {
+            task.shader->freeDescriptorSet(task.descriptorSet);
+        }
+    }
+
+    _tasks.clear();
+    _states.clear();
+    _program.release();
+}
@@ -0,0 +1,85 @@
+#ifndef __VE_TASK_GRAPH_H__
+#define __VE_TASK_GRAPH_H__
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include "ComputeProgram.h"
+#include "ComputeShader.h"
+
+// Dispatches added in program order, scheduled by the buffers they bind.
+// Read-after-write, write-after-write and write-after-read hazards are inferred from the access column of the
+// CSV (readonly / writeonly / read-write). Tasks without a path between them share a level and run without
+// barriers in between; one barrier per level covers only the buffers written by earlier levels.
+class TaskGraph
+{
+public:
+    // captures the shader's current buffers and push constants, returns the task index
+    int add(ComputeShader *shader, uint32_t threadGroupsX, uint32_t threadGroupsY, uint32_t threadGroupsZ);
+
+    // record the scheduled program, further add() calls start a new graph
+    void compile();
+
+    // compiles first if needed
+    void submit();
+
+    void wait();
+
+    inline void run()
+    {
+        submit();
+        wait();
+    }
+
+    // tasks a task waits for, valid after add()
+    inline const std::vector<int> &getDependencies(int task) const
+    {
+        return _tasks[task].dependencies;
+    }
+
+    inline int getLevel(int task) const
+    {
+        return _tasks[task].level;
+    }
+
+    inline int getLevelCount() const
+    {
+        return _levelCount;
+    }
+
+    inline int getBarrierCount() const
+    {
+        return _barrierCount;
+    }
+
+    void release();
+
+private:
+    struct Task
+    {
+        ComputeShader *shader;
+        uint32_t groups[3];
+        VkDescriptorSet descriptorSet;
+        std::vector<char> pushConstants;
+        std::vector<std::pair<ComputeBuffer *, BufferAccess>> accesses;
+        std::vector<int> dependencies;
+        int level;
+    };
+
+    struct BufferState
+    {
+        int lastWriter = -1;
+        std::vector<int> readers;
+    };
+
+    std::vector<Task> _tasks;
+    std::map<ComputeBuffer *, BufferState> _states;
+    ComputeProgram _program;
+    bool _compiled = false;
+    int _levelCount = 0;
+    int _barrierCount = 0;
+
+    void addDependency(Task &task, int other);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef __VE_THREAD_POOL_H__
+#define __VE_THREAD_POOL_H__
+
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+
+class ThreadPool
+{
+public:
+    // threads = 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned threads = 0)
+    {
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (unsigned i = 0; i != threads; ++i)
+        {
+            _workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+
+        _wakeup.notify_all();
+
+        for (auto &worker : _workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    template <typename F>
+    auto submit(F &&task) -> std::future<decltype(task())>
+    {
+        typedef decltype(task()) R;
+
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        std::future<R> future = packaged->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push([packaged] { (*packaged)(); });
+        }
+
+        _wakeup.notify_one();
+
+        return future;
+    }
+
+    inline size_t size() const
+    {
+        return _workers.size();
+    }
+
+private:
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _wakeup;
+    bool _stopping = false;
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wakeup.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+
+                if (_tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(_tasks.front());
+                _tasks.pop();
+            }
+
+            task();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef __VE_TYPED_COMPUTE_BUFFER_H__
+#define __VE_TYPED_COMPUTE_BUFFER_H__
+
+#include "ComputeBuffer.h"
+#include "Std430.h"
+#include <vector>
+#include <memory>
+#include <cstring>
+
+
+// ComputeBuffer whose stride is sizeof(T); T is checked at compile time against std430 packing, which needs
+// user structs to be described with STD430_STRUCT
+template <typename T>
+class TypedComputeBuffer : public ComputeBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "buffer element must be trivially copyable");
+    static_assert(std::is_standard_layout<T>::value, "buffer element must be standard layout");
+    static_assert(std430::Layout<T>::alignment != 0, "buffer element has no std430 layout, describe structs with STD430_STRUCT");
+    static_assert(sizeof(T) == std430::stride<T>(), "buffer element size differs from its std430 array stride");
+
+public:
+    TypedComputeBuffer(uint64_t count, ComputeBufferMode usage = Immutable) : ComputeBuffer(count, (int)sizeof(T), usage)
+    {
+    }
+
+    inline void setData(const T *array, uint64_t count, uint64_t srcOffset = 0, uint64_t dstOffset = 0)
+    {
+        ComputeBuffer::setData((void *)array, count, srcOffset, dstOffset);
+    }
+
+    inline void setData(const std::vector<T> &array, uint64_t dstOffset = 0)
+    {
+        ComputeBuffer::setData((void *)array.data(), array.size(), 0, dstOffset);
+    }
+
+    inline void getData(T *array, uint64_t count, uint64_t srcOffset = 0, uint64_t dstOffset = 0)
+    {
+        ComputeBuffer::getData((void *)array, count, srcOffset, dstOffset);
+    }
+
+    inline void getData(std::vector<T> &array, uint64_t srcOffset = 0)
+    {
+        ComputeBuffer::getData((void *)array.data(), array.size(), srcOffset, 0);
+    }
+
+    std::future<std::vector<T>> readAsync(uint64_t count, uint64_t srcOffset = 0)
+    {
+        auto promise = std::make_shared<std::promise<std::vector<T>>>();
+        std::future<std::vector<T>> future = promise->get_future();
+
+        ComputeBuffer::readAsync(count, srcOffset, [promise](const void *data, size_t size)
+        {
+            std::vector<T> values(size / sizeof(T));
+            memcpy(values.data(), data, values.size() * sizeof(T));
+            promise->set_value(std::move(values));
+        });
+
+        return future;
+    }
+};
+
+#endif
@@ -1,77 +1,452 @@
 #include "UniformData.h"
 #include "VulkanContext.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
-#define MAX_UNIFORM_COUNT 1024
+#define MAX_UNIFORM_BUFFER_SIZE (64 * 1024)
+#define UNIFORM_UPLOAD_SLOTS 8
 
-void UniformData::initialize()
+struct FieldType
+{
+    const char *name;
+    uint32_t size;
+    uint32_t alignment;
+    char scalar;
+};
+
+// std140 sizes and base alignments
+static const FieldType fieldTypes[] = {
+    {"float", 4, 4, 'f'}, {"int", 4, 4, 'i'}, {"uint", 4, 4, 'u'}, {"bool", 4, 4, 'u'},
+    {"vec2", 8, 8, 'f'}, {"vec3", 12, 16, 'f'}, {"vec4", 16, 16, 'f'},
+    {"ivec2", 8, 8, 'i'}, {"ivec3", 12, 16, 'i'}, {"ivec4", 16, 16, 'i'},
+    {"uvec2", 8, 8, 'u'}, {"uvec3", 12, 16, 'u'}, {"uvec4", 16, 16, 'u'},
+    {"mat4", 64, 16, 'f'},
+};
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::string trim(const std::string &s)
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return first == std::string::npos ? "" : s.substr(first, last - first + 1);
+}
+
+static bool isNumber(const std::string &s)
+{
+    char *end = nullptr;
+    strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
+static const FieldType &findFieldType(const std::string &name)
+{
+    for (const auto &type : fieldTypes)
+    {
+        if (name == type.name)
+        {
+            return type;
+        }
+    }
+
+    throw std::runtime_error("unsupported uniform field type: " + name);
+}
+
+static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &memory)
 {
     VkDevice device = VulkanContext::Instance().device;
-    uint32_t size = MAX_UNIFORM_COUNT * sizeof(Vector4);
 
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
-    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS)
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create buffer!");
     }
 
     VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, _buffer, &memRequirements);
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
     VkMemoryAllocateInfo memInfo{};
     memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     memInfo.allocationSize = memRequirements.size;
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     memInfo.memoryTypeIndex = VulkanContext::Instance().findMemoryType(memRequirements.memoryTypeBits, properties);
 
-    if (vkAllocateMemory(device, &memInfo, nullptr, &_bufferMemory) != VK_SUCCESS)
+    if (VulkanContext::Instance().allocateMemory(memInfo, &memory) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to allocate buffer memory!");
     }
 
-    vkBindBufferMemory(device, _buffer, _bufferMemory, 0);
+    if (vkBindBufferMemory(device, buffer, memory, 0) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+}
+
+void UniformData::initialize()
+{
+    VkDevice device = VulkanContext::Instance().device;
+
+    createBuffer(MAX_UNIFORM_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _buffer, _bufferMemory);
 
-    _descriptorBufferInfo.buffer = _buffer;
-    _descriptorBufferInfo.offset = 0;
-    _descriptorBufferInfo.range = size;
+    // one staging slot per upload that may still be pending on the queue
+    createBuffer((VkDeviceSize)MAX_UNIFORM_BUFFER_SIZE * UNIFORM_UPLOAD_SLOTS, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _stagingBuffer, _stagingMemory);
 
-    vkMapMemory(device, _bufferMemory, 0, size, 0, &_uniformBufferMapped);
+    if (vkMapMemory(device, _stagingMemory, 0, VK_WHOLE_SIZE, 0, (void **)&_stagingMapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map uniform staging memory!");
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    _slots.resize(UNIFORM_UPLOAD_SLOTS);
+    _nextSlot = 0;
+
+    for (auto &slot : _slots)
+    {
+        slot.commandBuffer = VulkanContext::Instance().allocateCommandBuffer();
+
+        if (vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create uniform upload fence!");
+        }
+    }
+
+    _shadow.assign(MAX_UNIFORM_BUFFER_SIZE, 0);
+
+    VulkanContext::Instance().executeOnce([&](VkCommandBuffer cmd)
+    {
+        vkCmdFillBuffer(cmd, _buffer, 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    });
 }
 
-void UniformData::updateMemory()
+void UniformData::updateMemory(VkQueue queue)
 {
-    memcpy(_uniformBufferMapped, _uniformDatas.data(), _uniformDatas.size() * sizeof(Vector4));
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    if (_dirtyRanges.empty() || _slots.empty())
+    {
+        return;
+    }
+
+    VkDevice device = VulkanContext::Instance().device;
+    UploadSlot &slot = _slots[_nextSlot];
+    VkDeviceSize base = (VkDeviceSize)_nextSlot * MAX_UNIFORM_BUFFER_SIZE;
+    _nextSlot = (_nextSlot + 1) % (uint32_t)_slots.size();
+
+    // the staging bytes of this slot are only reused once its previous copy has run
+    VulkanContext::Instance().waitForFence(slot.fence);
+
+    std::sort(_dirtyRanges.begin(), _dirtyRanges.end());
+
+    std::vector<VkBufferCopy> regions;
+    uint32_t begin = _dirtyRanges[0].first;
+    uint32_t end = _dirtyRanges[0].second;
+
+    for (size_t i = 1; i <= _dirtyRanges.size(); ++i)
+    {
+        if (i < _dirtyRanges.size() && _dirtyRanges[i].first <= end)
+        {
+            end = std::max(end, _dirtyRanges[i].second);
+            continue;
+        }
+
+        memcpy(_stagingMapped + base + begin, _shadow.data() + begin, end - begin);
+        regions.push_back({base + begin, begin, end - begin});
+
+        if (i < _dirtyRanges.size())
+        {
+            begin = _dirtyRanges[i].first;
+            end = _dirtyRanges[i].second;
+        }
+    }
+
+    _dirtyRanges.clear();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkResetCommandBuffer(slot.commandBuffer, 0);
+    vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+
+    // earlier submissions still reading the old values finish before they are overwritten
+    VkMemoryBarrier before{};
+    before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    before.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    before.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &before, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(slot.commandBuffer, _stagingBuffer, _buffer, (uint32_t)regions.size(), regions.data());
+
+    VkMemoryBarrier after{};
+    after.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    after.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    after.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+
+    vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &after, 0, nullptr, 0, nullptr);
+
+    if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record uniform upload!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+    vkResetFences(device, 1, &slot.fence);
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit uniform upload!");
+    }
 }
 
 void UniformData::release()
 {
     VkDevice device = VulkanContext::Instance().device;
 
+    for (auto &slot : _slots)
+    {
+        vkDestroyFence(device, slot.fence, nullptr);
+        VulkanContext::Instance().freeCommandBuffer(slot.commandBuffer);
+    }
+    _slots.clear();
+
+    vkDestroyBuffer(device, _stagingBuffer, nullptr);
+    VulkanContext::Instance().freeMemory(_stagingMemory);
+
     vkDestroyBuffer(device, _buffer, nullptr);
-    vkFreeMemory(device, _bufferMemory, nullptr);
+    VulkanContext::Instance().freeMemory(_bufferMemory);
+}
+
+void UniformData::addUniform(const std::string &name, const std::string &layout)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    if (_blocks.find(name) != _blocks.end())
+    {
+        return;
+    }
+
+    std::string fields = trim(layout);
+
+    if (fields.empty() || isNumber(fields))
+    {
+        fields = "float value=" + (fields.empty() ? std::string("0") : fields);
+    }
+
+    UniformBlock block;
+    std::vector<std::pair<std::string, std::vector<std::string>>> defaults;
+    uint32_t cursor = 0;
+
+    std::stringstream ss(fields);
+    std::string item;
+
+    while (std::getline(ss, item, ';'))
+    {
+        item = trim(item);
+        if (item.empty())
+        {
+            continue;
+        }
+
+        std::string declaration = item;
+        std::string values;
+        size_t assign = item.find('=');
+
+        if (assign != std::string::npos)
+        {
+            declaration = trim(item.substr(0, assign));
+            values = item.substr(assign + 1);
+        }
+
+        std::stringstream ds(declaration);
+        std::string typeName, fieldName;
+        ds >> typeName >> fieldName;
+
+        const FieldType &type = findFieldType(typeName);
+
+        UniformField field;
+        field.type = typeName;
+        field.size = type.size;
+        field.count = 1;
+
+        // any bracketed declaration is an array, float x[1] included
+        bool isArray = false;
+        size_t bracket = fieldName.find('[');
+        if (bracket != std::string::npos)
+        {
+            isArray = true;
+            field.count = (uint32_t)atoi(fieldName.c_str() + bracket + 1);
+            fieldName = fieldName.substr(0, bracket);
+
+            if (field.count == 0)
+            {
+                throw std::runtime_error("invalid uniform array length: " + declaration);
+            }
+        }
+
+        // std140: array elements and matrices are rounded up to vec4 alignment
+        uint32_t alignment = isArray ? alignUp(type.alignment, 16) : type.alignment;
+        field.stride = isArray ? alignUp(type.size, 16) : type.size;
+        field.offset = alignUp(cursor, alignment);
+        cursor = field.offset + field.stride * field.count;
+
+        block.fields[fieldName] = field;
+
+        std::stringstream vs(values);
+        std::vector<std::string> components;
+        std::string component;
+        while (vs >> component)
+        {
+            components.push_back(component);
+        }
+        defaults.push_back({fieldName, components});
+    }
+
+    uint32_t blockSize = alignUp(std::max(cursor, 4u), 16);
+    uint32_t alignment = (uint32_t)VulkanContext::Instance().getProperties().limits.minUniformBufferOffsetAlignment;
+    uint32_t offset = alignUp(_size, std::max(alignment, 16u));
+
+    if (offset + blockSize > MAX_UNIFORM_BUFFER_SIZE)
+    {
+        throw std::runtime_error("uniform buffer is full!");
+    }
+
+    _size = offset + blockSize;
+
+    block.info.buffer = _buffer;
+    block.info.offset = offset;
+    block.info.range = blockSize;
+
+    const UniformBlock &added = _blocks.insert(std::make_pair(name, block)).first->second;
+
+    for (const auto &value : defaults)
+    {
+        const UniformField &field = added.fields.at(value.first);
+        char scalar = findFieldType(field.type).scalar;
+        uint32_t components = field.size / 4;
+
+        for (size_t i = 0; i != value.second.size() && i < components * field.count; ++i)
+        {
+            uint32_t word;
+            const char *text = value.second[i].c_str();
+
+            if (scalar == 'f')
+            {
+                float f = (float)atof(text);
+                memcpy(&word, &f, 4);
+            }
+            else if (scalar == 'i')
+            {
+                int32_t n = (int32_t)strtol(text, nullptr, 0);
+                memcpy(&word, &n, 4);
+            }
+            else
+            {
+                word = (uint32_t)strtoul(text, nullptr, 0);
+            }
+
+            uint32_t element = (uint32_t)i / components;
+            write(added, field.offset + element * field.stride + ((uint32_t)i % components) * 4, &word, 4);
+        }
+    }
 }
 
-void UniformData::addUniform(const std::string &name)
+const UniformBlock &UniformData::getBlock(const std::string &name)
 {
-    auto it = _uniformsMap.find(name);
-    if (it == _uniformsMap.end())
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    auto it = _blocks.find(name);
+    if (it == _blocks.end())
+    {
+        throw std::runtime_error("failed to find uniform: " + name);
+    }
+    return it->second;
+}
+
+void UniformData::write(const UniformBlock &block, uint32_t offset, const void *data, size_t size)
+{
+    if (offset + size > block.info.range)
+    {
+        throw std::runtime_error("uniform write out of block range!");
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+    uint32_t begin = (uint32_t)block.info.offset + offset;
+    char *dst = _shadow.data() + begin;
+
+    // unchanged bytes do not need to reach the GPU again
+    if (memcmp(dst, data, size) == 0)
     {
-        _uniformsMap.insert(std::make_pair(name, (int)_uniformDatas.size()));
-        _uniformDatas.push_back({0.f, 0.f, 0.f, 0.f});
+        return;
     }
+
+    memcpy(dst, data, size);
+    _dirtyRanges.push_back({begin, begin + (uint32_t)size});
 }
 
 void UniformData::setUniform(const std::string &name, const Vector4 &value)
 {
-    auto it = _uniformsMap.find(name);
-    if (it == _uniformsMap.end())
+    const UniformBlock &block = getBlock(name);
+
+    // only the first field, the padding or fields behind it keep their values
+    uint32_t size = sizeof(float);
+    for (const auto &field : block.fields)
     {
-        throw std::runtime_error("failed to set uniform!");
+        if (field.second.offset == 0)
+        {
+            size = field.second.size;
+        }
     }
-    int i = it->second;
-    _uniformDatas[i] = value;
-}
\ No newline at end of file
+
+    write(block, 0, &value, std::min((size_t)size, sizeof(Vector4)));
+}
+
+void UniformData::setField(const std::string &name, const std::string &field, const void *data, size_t size, uint32_t index)
+{
+    const UniformBlock &block = getBlock(name);
+
+    auto it = block.fields.find(field);
+    if (it == block.fields.end())
+    {
+        throw std::runtime_error("failed to find uniform field: " + name + "." + field);
+    }
+
+    const UniformField &f = it->second;
+
+    // a padded host vec3 (16 bytes) is accepted for a std140 vec3
+    if ((size != f.size && !(f.size == 12 && size == 16)) || index >= f.count)
+    {
+        throw std::runtime_error("uniform field type mismatch: " + name + "." + field + " is " + f.type);
+    }
+
+    write(block, f.offset + index * f.stride, data, f.size);
+}
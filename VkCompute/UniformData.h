@@ -6,6 +6,9 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
 
 
 struct Vector4
@@ -16,7 +19,25 @@ struct Vector4
     float w;
 };
 
+struct UniformField
+{
+    std::string type;
+    uint32_t offset; // std140 offset inside the block
+    uint32_t size;   // bytes of one element
+    uint32_t stride; // std140 array stride, a multiple of 16 for arrays
+    uint32_t count;  // array length, 1 for non arrays
+};
+
+struct UniformBlock
+{
+    VkDescriptorBufferInfo info;
+    std::map<std::string, UniformField> fields;
+};
 
+// All uniform blocks live in one device buffer, each at its own aligned offset.
+// Writes go to a host shadow copy. Every submission that follows a change is preceded on the queue
+// by a copy of the changed byte ranges from its own staging slot, so work already in flight keeps
+// the values it was submitted with.
 class UniformData : public Singleton<UniformData>
 {
 public:
@@ -24,24 +45,61 @@ public:
 
     void release();
 
-    void updateMemory();
+    // called by VulkanContext with the queue locked, right before each submission
+    void updateMemory(VkQueue queue);
 
-    void addUniform(const std::string &name);
+    // layout is the value column of the binding CSV: either a legacy float ("0.5") or std140 fields
+    // separated by ';' with optional defaults, e.g. "float deltaTime=0.5;vec4 tint=1 1 1 1;uint steps"
+    void addUniform(const std::string &name, const std::string &layout = "");
 
+    // legacy, writes the leading components of value into the first field of the block
     void setUniform(const std::string &name, const Vector4 &value);
 
-    inline VkDescriptorBufferInfo* getDescriptorBufferInfo()
+    void setField(const std::string &name, const std::string &field, const void *data, size_t size, uint32_t index = 0);
+
+    template <typename T>
+    void set(const std::string &name, const std::string &field, const T &value, uint32_t index = 0)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "uniform value must be trivially copyable");
+        setField(name, field, &value, sizeof(T), index);
+    }
+
+    // whole block at once, T must follow std140 layout
+    template <typename T>
+    void setBlock(const std::string &name, const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "uniform block must be trivially copyable");
+        write(getBlock(name), 0, &value, sizeof(T));
+    }
+
+    const UniformBlock &getBlock(const std::string &name);
+
+    inline const VkDescriptorBufferInfo *getDescriptorBufferInfo(const std::string &name)
     {
-        return &_descriptorBufferInfo;
+        return &getBlock(name).info;
     }
 
 private:
-    void* _uniformBufferMapped;
-    std::vector<Vector4> _uniformDatas;
-    std::map<std::string, int> _uniformsMap;
+    struct UploadSlot
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+    };
+
+    std::vector<UploadSlot> _slots;
+    uint32_t _nextSlot = 0;
+    VkBuffer _stagingBuffer;
+    VkDeviceMemory _stagingMemory;
+    char *_stagingMapped;
+    uint32_t _size = 0;
+    std::vector<char> _shadow;
+    std::vector<std::pair<uint32_t, uint32_t>> _dirtyRanges;
+    std::map<std::string, UniformBlock> _blocks;
+    std::recursive_mutex _mutex; // shaders may be created on several threads
     VkBuffer _buffer;
     VkDeviceMemory _bufferMemory;
-    VkDescriptorBufferInfo _descriptorBufferInfo;
+
+    void write(const UniformBlock &block, uint32_t offset, const void *data, size_t size);
 };
 
-#endif
\ No newline at end of file
+#endif
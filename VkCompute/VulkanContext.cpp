@@ -1,13 +1,29 @@
 #include "VulkanContext.h"
 #include <stdexcept>
 #include <set>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 #include "UniformData.h"
+#include "AsyncReadback.h"
+#include "Metrics.h"
+#include "ResidencyManager.h"
+#include "BindlessHeap.h"
 
 
 const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
 const std::vector<const char *> deviceExtensions = {};
 
+// enabled only when the device supports them, query with VulkanContext::isExtensionEnabled
+const std::vector<const char *> optionalDeviceExtensions = {
+    VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+    VK_KHR_EXTERNAL_FENCE_FD_EXTENSION_NAME,
+};
+
 void DestroyDebugUtilsMessengerEXT(VkInstance _instance, VkDebugUtilsMessengerEXT _debugMessenger, const VkAllocationCallbacks *pAllocator)
 {
     auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(_instance, "vkDestroyDebugUtilsMessengerEXT");
@@ -37,8 +53,15 @@ void VulkanContext::initialize()
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandBuffer();
+    createPipelineCache();
 
     UniformData::Instance().initialize();
+    AsyncReadback::Instance().initialize();
+
+    if (isExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+    {
+        BindlessHeap::Instance().initialize();
+    }
 }
 
 void VulkanContext::setupDebugMessenger()
@@ -81,6 +104,9 @@ void VulkanContext::pickPhysicalDevice()
     {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+
+    vkGetPhysicalDeviceProperties(_physicalDevice, &_properties);
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
 }
 
 QueueFamilyIndices VulkanContext::findQueueFamilies()
@@ -173,8 +199,63 @@ void VulkanContext::createLogicalDevice()
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    std::vector<const char *> extensions(deviceExtensions.begin(), deviceExtensions.end());
+
+    for (const char *name : optionalDeviceExtensions)
+    {
+        for (const auto &extension : availableExtensions)
+        {
+            if (strcmp(name, extension.extensionName) == 0)
+            {
+                extensions.push_back(name);
+                break;
+            }
+        }
+    }
+
+    // bindless needs update-after-bind, partially bound runtime arrays of storage buffers
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    auto indexing = std::find_if(extensions.begin(), extensions.end(), [](const char *name) { return strcmp(name, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0; });
+
+    if (indexing != extensions.end())
+    {
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(_physicalDevice, &features);
+
+        if (indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind && indexingFeatures.descriptorBindingUpdateUnusedWhilePending)
+        {
+            VkPhysicalDeviceDescriptorIndexingFeatures enabled{};
+            enabled.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+            enabled.runtimeDescriptorArray = VK_TRUE;
+            enabled.descriptorBindingPartiallyBound = VK_TRUE;
+            enabled.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            enabled.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            enabled.shaderStorageBufferArrayNonUniformIndexing = indexingFeatures.shaderStorageBufferArrayNonUniformIndexing;
+            indexingFeatures = enabled;
+
+            createInfo.pNext = &indexingFeatures;
+        }
+        else
+        {
+            extensions.erase(indexing);
+        }
+    }
+
+    _enabledExtensions = std::set<std::string>(extensions.begin(), extensions.end());
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers)
     {
@@ -192,6 +273,24 @@ void VulkanContext::createLogicalDevice()
     }
 
     vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &_computeQueue);
+
+    if (isExtensionEnabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties{};
+        hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &hostProperties;
+
+        vkGetPhysicalDeviceProperties2(_physicalDevice, &properties);
+        _hostPointerAlignment = hostProperties.minImportedHostPointerAlignment;
+    }
+}
+
+bool VulkanContext::isExtensionEnabled(const std::string &name)
+{
+    return _enabledExtensions.count(name) != 0;
 }
 
 bool VulkanContext::checkValidationLayerSupport()
@@ -246,7 +345,7 @@ void VulkanContext::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -292,10 +391,14 @@ std::vector<const char *> VulkanContext::getRequiredExtensions()
 
 void VulkanContext::release()
 {
+    AsyncReadback::Instance().release();
+
     vkDeviceWaitIdle(device);
     
     UniformData::Instance().release();
+    BindlessHeap::Instance().release();
 
+    vkDestroyPipelineCache(device, _pipelineCache, nullptr);
     vkDestroyCommandPool(device, _commandPool, nullptr);
 
     vkDestroySemaphore(device, _computeFinishedSemaphore, nullptr);
@@ -365,28 +468,255 @@ void VulkanContext::createCommandBuffer()
     }
 }
 
+void VulkanContext::createPipelineCache()
+{
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &_pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+VkCommandBuffer VulkanContext::allocateCommandBuffer()
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+
+    std::lock_guard<std::mutex> lock(_queueMutex);
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate compute command buffers!");
+    }
+
+    return commandBuffer;
+}
+
+void VulkanContext::freeCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    vkFreeCommandBuffers(device, _commandPool, 1, &commandBuffer);
+}
+
+VkResult VulkanContext::allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory *memory)
+{
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, memory);
+
+    if (result == VK_SUCCESS)
+    {
+        Metrics::Instance().recordAllocation(allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+
+        std::lock_guard<std::mutex> lock(_allocationMutex);
+        _allocations[*memory] = std::make_pair(allocInfo.memoryTypeIndex, allocInfo.allocationSize);
+    }
+
+    return result;
+}
+
+void VulkanContext::freeMemory(VkDeviceMemory memory)
+{
+    {
+        std::lock_guard<std::mutex> lock(_allocationMutex);
+        auto it = _allocations.find(memory);
+
+        if (it != _allocations.end())
+        {
+            Metrics::Instance().recordFree(it->second.first, it->second.second);
+            _allocations.erase(it);
+        }
+    }
+
+    vkFreeMemory(device, memory, nullptr);
+}
+
+std::vector<HeapBudget> VulkanContext::getMemoryBudget()
+{
+    std::vector<HeapBudget> heaps(_memoryProperties.memoryHeapCount);
+
+    for (uint32_t i = 0; i != _memoryProperties.memoryHeapCount; ++i)
+    {
+        heaps[i].size = _memoryProperties.memoryHeaps[i].size;
+        heaps[i].budget = heaps[i].size;
+        heaps[i].deviceLocal = (_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    if (isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+
+        vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &properties);
+
+        for (uint32_t i = 0; i != _memoryProperties.memoryHeapCount; ++i)
+        {
+            heaps[i].budget = budgetProperties.heapBudget[i];
+            heaps[i].usage = budgetProperties.heapUsage[i];
+        }
+
+        return heaps;
+    }
+
+    // without the extension only our own allocations are known, other processes are invisible
+    std::lock_guard<std::mutex> lock(_allocationMutex);
+
+    for (const auto &it : _allocations)
+    {
+        heaps[_memoryProperties.memoryTypes[it.second.first].heapIndex].usage += it.second.second;
+    }
+
+    return heaps;
+}
+
+void VulkanContext::executeOnce(const std::function<void(VkCommandBuffer)> &record)
+{
+    VkCommandBuffer cmd = allocateCommandBuffer();
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create one-shot fence!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    record(cmd);
+
+    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record one-shot command buffer!");
+    }
+
+    submit(cmd, fence);
+    waitForFence(fence);
+
+    vkDestroyFence(device, fence, nullptr);
+    freeCommandBuffer(cmd);
+}
+
+void VulkanContext::copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
+{
+    executeOnce([&](VkCommandBuffer cmd)
+    {
+        // earlier dispatches may still be writing src
+        VkMemoryBarrier before{};
+        before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        before.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        before.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &before, 0, nullptr, 0, nullptr);
+
+        VkBufferCopy region{};
+        region.srcOffset = srcOffset;
+        region.dstOffset = dstOffset;
+        region.size = size;
+        vkCmdCopyBuffer(cmd, src, dst, 1, &region);
+
+        VkMemoryBarrier after{};
+        after.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        after.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        after.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &after, 0, nullptr, 0, nullptr);
+    });
+}
+
+void VulkanContext::signalFence(VkFence fence)
+{
+    std::lock_guard<std::mutex> lock(_queueMutex);
+
+    if (vkQueueSubmit(_computeQueue, 0, nullptr, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit fence signal!");
+    }
+}
+
+void VulkanContext::waitForFence(VkFence fence)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+    Metrics::Instance().recordFenceWait(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void VulkanContext::submit(VkCommandBuffer commandBuffer, VkFence fence)
+{
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    std::lock_guard<std::mutex> lock(_queueMutex);
+
+    // uniform changes since the last submission are copied in ahead of it
+    UniformData::Instance().updateMemory(_computeQueue);
+
+    if (vkQueueSubmit(_computeQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit compute command buffer!");
+    }
+
+    Metrics::Instance().recordSubmit();
+}
+
 void VulkanContext::reset()
 {
+    waitForFence(_computeInFlightFence);
+    ResidencyManager::Instance().completed();
     vkResetCommandBuffer(_commandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
 }
 
-void VulkanContext::compute()
+void VulkanContext::compute(bool wait)
 {
-    vkWaitForFences(device, 1, &_computeInFlightFence, VK_TRUE, UINT64_MAX);
-    UniformData::Instance().updateMemory();
+    waitForFence(_computeInFlightFence);
+    ResidencyManager::Instance().completed();
     vkResetFences(device, 1, &_computeInFlightFence);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &_commandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &_computeFinishedSemaphore;
 
-    if (vkQueueSubmit(_computeQueue, 1, &submitInfo, _computeInFlightFence) != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to submit compute command buffer!");
-    };
+        std::lock_guard<std::mutex> lock(_queueMutex);
 
-    vkQueueWaitIdle(_computeQueue);
+        UniformData::Instance().updateMemory(_computeQueue);
+
+        if (vkQueueSubmit(_computeQueue, 1, &submitInfo, _computeInFlightFence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit compute command buffer!");
+        }
+    }
+
+    Metrics::Instance().recordSubmit();
+    ResidencyManager::Instance().submitted();
+
+    if (wait)
+    {
+        // only this submission, other threads keep submitting while it runs
+        waitForFence(_computeInFlightFence);
+
+        ResidencyManager::Instance().completed();
+    }
 }
@@ -3,13 +3,26 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <set>
+#include <string>
 #include <iostream>
 #include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
 #include "Singleton.h"
 #include "ComputeBuffer.h"
 #include "ComputeShader.h"
 
 
+struct HeapBudget
+{
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0; // what this process may use, the heap size without VK_EXT_memory_budget
+    VkDeviceSize usage = 0;  // process wide with VK_EXT_memory_budget, else the allocations made through allocateMemory
+    bool deviceLocal = false;
+};
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -36,7 +49,8 @@ public:
 
     void reset();
 
-    void compute();
+    // wait = false returns right after the submit, the next reset() waits for it instead
+    void compute(bool wait = true);
 
     void release();
 
@@ -45,8 +59,65 @@ public:
         return _commandBuffer;
     }
 
+    inline VkPhysicalDevice getPhysicalDevice()
+    {
+        return _physicalDevice;
+    }
+
+    // shared by every compute pipeline, internally synchronized
+    inline VkPipelineCache getPipelineCache()
+    {
+        return _pipelineCache;
+    }
+
+    inline const VkPhysicalDeviceProperties& getProperties()
+    {
+        return _properties;
+    }
+
+    inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties()
+    {
+        return _memoryProperties;
+    }
+
+    // extra primary command buffers for executors that keep several submissions in flight
+    VkCommandBuffer allocateCommandBuffer();
+
+    void freeCommandBuffer(VkCommandBuffer commandBuffer);
+
+    // thread safe submit of an externally recorded command buffer, fence may be VK_NULL_HANDLE
+    void submit(VkCommandBuffer commandBuffer, VkFence fence);
+
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+    // vkAllocateMemory / vkFreeMemory with the allocation recorded in Metrics
+    VkResult allocateMemory(const VkMemoryAllocateInfo &allocInfo, VkDeviceMemory *memory);
+
+    void freeMemory(VkDeviceMemory memory);
+
+    // empty submission, the fence signals once everything submitted before has finished
+    void signalFence(VkFence fence);
+
+    // blocking vkWaitForFences with the stall recorded in Metrics, the fence is left signalled
+    void waitForFence(VkFence fence);
+
+    // budget and usage of every memory heap
+    std::vector<HeapBudget> getMemoryBudget();
+
+    // record into a fresh command buffer, submit it and wait for it to finish
+    void executeOnce(const std::function<void(VkCommandBuffer)> &record);
+
+    // one-shot vkCmdCopyBuffer after all earlier submissions, returns when the copy is done
+    void copyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+
+    bool isExtensionEnabled(const std::string &name);
+
+    // minImportedHostPointerAlignment, 0 when VK_EXT_external_memory_host is unavailable
+    inline VkDeviceSize getHostPointerAlignment()
+    {
+        return _hostPointerAlignment;
+    }
+
     QueueFamilyIndices findQueueFamilies();
 
 private:
@@ -79,17 +150,28 @@ private:
 
     void createCommandBuffer();
 
+    void createPipelineCache();
+
 private:
     VkInstance _instance;
     VkDebugUtilsMessengerEXT _debugMessenger;
     VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties _properties;
+    VkPhysicalDeviceMemoryProperties _memoryProperties{};
+    std::set<std::string> _enabledExtensions;
+    VkDeviceSize _hostPointerAlignment = 0;
 
     VkQueue _computeQueue;
+    std::mutex _queueMutex;
     VkFence _computeInFlightFence;
     VkSemaphore _computeFinishedSemaphore;
 
     VkCommandBuffer _commandBuffer;
     VkCommandPool _commandPool;
+    VkPipelineCache _pipelineCache;
+
+    std::mutex _allocationMutex;
+    std::unordered_map<VkDeviceMemory, std::pair<uint32_t, VkDeviceSize>> _allocations;
 };
 
 #endif
\ No newline at end of file
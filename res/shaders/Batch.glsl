@@ -0,0 +1,12 @@
+// Segment lookup for SegmentBatch kernels. BatchKernels launches one workgroup per segment, folded into
+// the y dimension when there are more segments than maxComputeWorkGroupCount[0].
+
+layout(push_constant) uniform BatchArgs {
+    uint segmentCount;
+} batch;
+
+// index of the segment this workgroup works on, >= batch.segmentCount for padding groups
+uint batchSegment()
+{
+    return gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+}
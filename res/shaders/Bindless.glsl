@@ -0,0 +1,17 @@
+// Storage buffers of the BindlessHeap (set 1), indexed by ComputeBuffer::getBindlessIndex().
+// Declare a "bindless" row in the CSV and pass the indices through push constants.
+// Indices that differ between invocations of a workgroup must be wrapped in nonuniformEXT().
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(std430, set = 1, binding = 0) buffer BindlessFloat {
+    float data[];
+} bindlessFloat[];
+
+layout(std430, set = 1, binding = 0) buffer BindlessUint {
+    uint data[];
+} bindlessUint[];
+
+layout(std430, set = 1, binding = 0) buffer BindlessVec4 {
+    vec4 data[];
+} bindlessVec4[];
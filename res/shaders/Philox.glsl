@@ -0,0 +1,79 @@
+// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011). Every 128-bit counter maps to four
+// independent 32-bit words under a 64-bit key, so any element of a sequence is computed without state and
+// the same seed and stream give the same numbers on every device. RandomGenerator::philox is the host copy.
+//
+// Sequence convention shared with Random.comp: key = seed, counter = (index lo, index hi, stream, step).
+//
+//   RandomState rng = rngInit(seed, stream, gl_GlobalInvocationID.x);
+//   vec4 u = rngUniform(rngNext(rng));
+//   vec4 n = rngNormal(rngNext(rng));
+
+const uint PHILOX_M0 = 0xD2511F53u;
+const uint PHILOX_M1 = 0xCD9E8D57u;
+const uint PHILOX_W0 = 0x9E3779B9u;
+const uint PHILOX_W1 = 0xBB67AE85u;
+
+uvec4 philox4x32(uvec4 counter, uvec2 key)
+{
+    for (int round = 0; round < 10; ++round) {
+        uint hi0, lo0, hi1, lo1;
+        umulExtended(PHILOX_M0, counter.x, hi0, lo0);
+        umulExtended(PHILOX_M1, counter.z, hi1, lo1);
+
+        counter = uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+        key += uvec2(PHILOX_W0, PHILOX_W1);
+    }
+
+    return counter;
+}
+
+struct RandomState {
+    uvec4 counter;
+    uvec2 key;
+};
+
+RandomState rngInit(uvec2 seed, uint stream, uint index)
+{
+    RandomState state;
+    state.counter = uvec4(index, 0u, stream, 0u);
+    state.key = seed;
+    return state;
+}
+
+// four fresh words per call
+uvec4 rngNext(inout RandomState state)
+{
+    uvec4 bits = philox4x32(state.counter, state.key);
+    state.counter.w++;
+    return bits;
+}
+
+// [0, 1) with 24 bits of precision, exactly representable in a float; low + u * (high - low) can round up
+// to high, clamp it with min(..., below high) to keep [low, high) as Random.comp does
+vec4 rngUniform(uvec4 bits)
+{
+    return vec4(bits >> 8u) * (1.0 / 16777216.0);
+}
+
+// standard normal through Box-Muller on pairs of words
+vec4 rngNormal(uvec4 bits)
+{
+    // (0, 1] keeps log() finite
+    vec2 u = (vec2(bits.xz >> 8u) + 1.0) * (1.0 / 16777216.0);
+    vec2 angle = vec2(bits.yw >> 8u) * (6.28318530718 / 16777216.0);
+    vec2 radius = sqrt(-2.0 * log(u));
+
+    return vec4(radius.x * cos(angle.x), radius.x * sin(angle.x), radius.y * cos(angle.y), radius.y * sin(angle.y));
+}
+
+// [0, range) by the high word of bits * range, biased by at most range / 2^32; range 0 means all 32 bits
+uint rngRange(uint bits, uint range)
+{
+    if (range == 0u) {
+        return bits;
+    }
+
+    uint hi, lo;
+    umulExtended(bits, range, hi, lo);
+    return hi;
+}
@@ -0,0 +1,21 @@
+// Convergence control for IterativeSolver. Define SOLVER_BINDING to the binding of the control buffer,
+// declared in the CSV as a buffer row with stride 4, before including this file.
+
+layout(std430, binding = SOLVER_BINDING) buffer SolverControl {
+    uvec4 args;       // group counts of the running iteration, written by the solver
+    uvec4 next;       // group counts of the next iteration, next.x is cleared before each one
+    uint iterations;  // iterations that ran
+} solver;
+
+// Call once per invocation with whether its part of the problem has converged. Any invocation that has not
+// keeps the loop going; when all have, the remaining recorded iterations dispatch no workgroups.
+void solverStep(bool converged)
+{
+    if (gl_GlobalInvocationID == uvec3(0)) {
+        atomicAdd(solver.iterations, 1u);
+    }
+
+    if (!converged) {
+        atomicMax(solver.next.x, gl_NumWorkGroups.x);
+    }
+}
@@ -0,0 +1,278 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/CpuBackend.h"
+#include "../VkCompute/ElementwiseDispatcher.h"
+#include "../VkCompute/AutoTuner.h"
+#include "../VkCompute/BatchKernels.h"
+#include "../VkCompute/SegmentBatch.h"
+#include "../VkCompute/ComputeProgram.h"
+#include "../VkCompute/ComputeBufferView.h"
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+bool verify(const std::vector<float> &in, const std::vector<float> &out, size_t count, float value)
+{
+    for (size_t i = 0; i != count; ++i)
+    {
+        if (out[i] != in[i] + value)
+        {
+            std::cerr << "mismatch at " << i << " of " << count << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    try
+    {
+        const size_t sizes[] = {1, 7, 1000, 65539, 1 << 20};
+
+        std::vector<float> in(1 << 20);
+        std::vector<float> out(1 << 20);
+
+        for (size_t i = 0; i != in.size(); ++i)
+        {
+            in[i] = (float)(i % 1000);
+        }
+
+        // host only, no Vulkan needed
+        ElementwiseDispatcher host;
+
+        std::cout << "cpu backend: " << CpuBackend::Instance().getIsa() << ", " << CpuBackend::Instance().getThreadCount() << " threads" << std::endl;
+
+        for (size_t count : sizes)
+        {
+            if (host.run(in.data(), out.data(), count, 0.5f) != DispatchCpu || !verify(in, out, count, 0.5f))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        VulkanContext::Instance().initialize();
+
+        ComputeShader *cs = new ComputeShader("../res/shaders/ComputeShader.csv");
+
+        // force the GPU path for everything but the single float
+        ElementwiseDispatcher hybrid(cs, 4);
+
+        for (size_t count : sizes)
+        {
+            DispatchTarget target = hybrid.run(in.data(), out.data(), count, 2.0f);
+
+            if (target != (count >= 4 ? DispatchGpu : DispatchCpu) || !verify(in, out, count, 2.0f))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::cout << "calibrated threshold: " << hybrid.calibrate(1 << 20) << " floats" << std::endl;
+
+        hybrid.release();
+        cs->release();
+
+        // tune local_size_x for 1M floats, the second load must come from the profile
+        std::remove("vkcompute-tuning.txt");
+
+        ComputeBuffer *tuneIn = new ComputeBuffer(1 << 18, 16, Dynamic);
+        ComputeBuffer *tuneOut = new ComputeBuffer(1 << 18, 16, Dynamic);
+
+        TuneWorkload workload;
+        workload.bind = [&](ComputeShader *shader)
+        {
+            shader->setBuffer("ParticleSSBOIn", tuneIn);
+            shader->setBuffer("ParticleSSBOOut", tuneOut);
+        };
+        workload.groups = [](const TuneConfig &config, uint32_t &x, uint32_t &y, uint32_t &z)
+        {
+            x = (1u << 18) / config.at(0);
+        };
+
+        TuneResult tuned;
+        ComputeShader *first = AutoTuner("vkcompute-tuning.txt").load("../res/shaders/ComputeShader.csv", "ComputeShader/1048576", AutoTuner::workgroupSizes(), workload, &tuned);
+        first->release();
+
+        ComputeShader *second = AutoTuner("vkcompute-tuning.txt").load("../res/shaders/ComputeShader.csv", "ComputeShader/1048576", AutoTuner::workgroupSizes(), workload, &tuned);
+
+        std::cout << "tuned local_size_x: " << tuned.config.at(0) << ", " << tuned.seconds * 1e6 << " us" << std::endl;
+
+        ElementwiseDispatcher tunedDispatcher(second, 4);
+        workload.bind(second);
+
+        if (!tuned.fromProfile || tunedDispatcher.run(in.data(), out.data(), 1 << 20, 1.0f) != DispatchGpu || !verify(in, out, 1 << 20, 1.0f))
+        {
+            return EXIT_FAILURE;
+        }
+
+        // the dispatcher runs through its own descriptor set, the caller's bindings survive
+        std::vector<std::pair<ComputeBuffer *, BufferAccess>> bound = second->getBufferAccesses();
+
+        if (bound.size() != 2 || bound[0].first != tuneIn || bound[1].first != tuneOut)
+        {
+            std::cerr << "dispatcher changed the shader's bindings" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        tunedDispatcher.release();
+        second->release();
+        tuneIn->release();
+        tuneOut->release();
+
+        // mixed length and empty segments, more of them than one grid row holds; quarters keep every sum exact
+        const uint32_t SEGMENT_COUNT = 700;
+
+        BatchKernels kernels;
+        kernels.setMaxGroupsX(64);
+
+        SegmentBatch batch, values, matrices, vectors, products;
+        std::vector<float> addends(SEGMENT_COUNT);
+
+        for (uint32_t s = 0; s != SEGMENT_COUNT; ++s)
+        {
+            std::vector<float> segment(s % 7 == 0 ? 0 : (s * 131) % 600);
+
+            for (size_t i = 0; i != segment.size(); ++i)
+            {
+                segment[i] = (float)((int)((s + i) % 13) - 6) * 0.25f;
+            }
+
+            batch.add(segment);
+            addends[s] = (float)(s % 5) - 2.0f;
+
+            uint32_t rows = s % 5 == 0 ? 0 : (s * 7) % 300;
+            uint32_t cols = s % 3 == 0 ? 0 : s % 9 + 1;
+            std::vector<float> matrix(rows * cols), vector(cols);
+
+            for (size_t i = 0; i != matrix.size(); ++i)
+            {
+                matrix[i] = (float)((int)((s * 3 + i) % 9) - 4);
+            }
+
+            for (size_t i = 0; i != vector.size(); ++i)
+            {
+                vector[i] = (float)((int)((s + i) % 5) - 2);
+            }
+
+            matrices.add(matrix);
+            vectors.add(vector);
+        }
+
+        kernels.add(batch, addends, values);
+        std::vector<float> sums = kernels.reduce(batch);
+        kernels.matvec(matrices, vectors, products);
+
+        if (values.getSegmentCount() != SEGMENT_COUNT || sums.size() != SEGMENT_COUNT || products.getSegmentCount() != SEGMENT_COUNT)
+        {
+            std::cerr << "batched kernels returned the wrong number of segments" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        for (uint32_t s = 0; s != SEGMENT_COUNT; ++s)
+        {
+            std::vector<float> segment = batch.get(s);
+            std::vector<float> added = values.get(s);
+            float sum = 0.0f;
+
+            if (added.size() != segment.size())
+            {
+                std::cerr << "batched add resized segment " << s << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            for (size_t i = 0; i != segment.size(); ++i)
+            {
+                sum += segment[i];
+
+                if (added[i] != segment[i] + addends[s])
+                {
+                    std::cerr << "batched add mismatch in segment " << s << " at " << i << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            if (sums[s] != sum)
+            {
+                std::cerr << "batched reduce mismatch in segment " << s << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::vector<float> matrix = matrices.get(s), vector = vectors.get(s), product = products.get(s);
+            size_t rows = vector.empty() ? 0 : matrix.size() / vector.size();
+
+            if (product.size() != rows)
+            {
+                std::cerr << "batched matvec produced " << product.size() << " rows for segment " << s << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            for (size_t row = 0; row != rows; ++row)
+            {
+                float dot = 0.0f;
+
+                for (size_t col = 0; col != vector.size(); ++col)
+                {
+                    dot += matrix[row * vector.size() + col] * vector[col];
+                }
+
+                if (product[row] != dot)
+                {
+                    std::cerr << "batched matvec mismatch in segment " << s << " at row " << row << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        // device results not downloaded yet must survive growth, reserved segments must read back as zeros
+        SegmentBatch growing;
+        growing.add(std::vector<float>(100, 1.0f));
+        growing.upload();
+
+        float two = 2.0f;
+        uint32_t twoBits;
+        std::memcpy(&twoBits, &two, sizeof(twoBits));
+
+        ComputeProgram overwrite;
+        overwrite.begin();
+        overwrite.fill(growing.getValues(), twoBits);
+        overwrite.end();
+        overwrite.run();
+        overwrite.release();
+
+        growing.reserve(50);
+        growing.add(std::vector<float>(1000, 3.0f));
+        growing.upload();
+        growing.download();
+
+        for (uint32_t i = 0; i != growing.getTotalCount(); ++i)
+        {
+            float expected = i < 100 ? 2.0f : (i < 150 ? 0.0f : 3.0f);
+
+            if (growing.data(0)[i] != expected)
+            {
+                std::cerr << "grown segment batch mismatch at " << i << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        growing.release();
+
+        for (SegmentBatch *segments : {&batch, &values, &matrices, &vectors, &products})
+        {
+            segments->release();
+        }
+
+        kernels.release();
+
+        VulkanContext::Instance().release();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
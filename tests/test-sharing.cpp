@@ -0,0 +1,256 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/TypedComputeBuffer.h"
+#include "../VkCompute/SharedFence.h"
+#include "../VkCompute/FdChannel.h"
+#include "../VkCompute/JobServer.h"
+#include "../VkCompute/JobClient.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+const uint32_t PARTICLE_COUNT = 8192;
+
+struct Particle
+{
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+STD430_STRUCT(Particle, float, float, float, float);
+
+void check(bool condition, const char *message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+bool isSupported()
+{
+    return VulkanContext::Instance().isExtensionEnabled(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME) &&
+           VulkanContext::Instance().isExtensionEnabled(VK_KHR_EXTERNAL_FENCE_FD_EXTENSION_NAME);
+}
+
+// consumer: import the producer's output and check it without any copy through the socket
+int consumer(const std::string &path)
+{
+    FdChannel *channel = FdChannel::connect(path);
+
+    VulkanContext::Instance().initialize();
+
+    char supported = isSupported();
+    channel->send(&supported, 1);
+
+    if (!supported)
+    {
+        channel->release();
+        VulkanContext::Instance().release();
+        return EXIT_SUCCESS;
+    }
+
+    SharedFence *fence = nullptr;
+    ComputeBuffer *shared = channel->receiveBuffer(&fence);
+
+    check(fence != nullptr && shared->getCount() == PARTICLE_COUNT, "shared buffer header is wrong!");
+
+    fence->wait();
+
+    std::vector<Particle> particles(PARTICLE_COUNT);
+    shared->getData(particles.data(), PARTICLE_COUNT);
+
+    for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+    {
+        check(particles[i].r == (float)i + 0.5f, "shared buffer has wrong contents!");
+    }
+
+    char done = 1;
+    channel->send(&done, 1);
+
+    fence->release();
+    delete fence;
+    shared->release();
+    delete shared;
+    channel->release();
+    delete channel;
+
+    VulkanContext::Instance().release();
+
+    return EXIT_SUCCESS;
+}
+
+// a job server in this process, one add job and one sum job from a client, and an attach that overstates its region
+void jobs()
+{
+    const uint32_t JOB_CAPACITY = 4096;
+    const uint32_t ADD_OFFSET = 100, ADD_COUNT = 1000;
+    const uint32_t SUM_OFFSET = 2001, SUM_COUNT = 777;
+
+    std::string path = "/tmp/vkcompute-jobs-" + std::to_string(getpid()) + ".sock";
+
+    JobServer server(path);
+    std::thread executor(&JobServer::run, &server);
+
+    try
+    {
+        JobClient client(path, JOB_CAPACITY);
+
+        for (uint32_t i = 0; i != JOB_CAPACITY; ++i)
+        {
+            client.data()[i] = (float)(i % 10);
+        }
+
+        JobReply added = client.add(ADD_OFFSET, ADD_COUNT, 0.5f);
+        check(added.status == 0, "add job failed!");
+
+        for (uint32_t i = 0; i != JOB_CAPACITY; ++i)
+        {
+            bool inside = i >= ADD_OFFSET && i < ADD_OFFSET + ADD_COUNT;
+            check(client.data()[i] == (float)(i % 10) + (inside ? 0.5f : 0.0f), "add job wrote wrong values!");
+        }
+
+        float expected = 0.0f;
+        for (uint32_t i = SUM_OFFSET; i != SUM_OFFSET + SUM_COUNT; ++i)
+        {
+            expected += (float)(i % 10);
+        }
+
+        JobReply summed = client.sum(SUM_OFFSET, SUM_COUNT);
+        check(summed.status == 0 && summed.result == expected, "sum job returned a wrong result!");
+
+        client.release();
+
+        // claims JOB_CAPACITY floats for a region of 16 bytes
+        std::string name = "/vkcompute-short-" + std::to_string(getpid());
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        check(fd >= 0, "failed to create shared memory!");
+        shm_unlink(name.c_str());
+        check(ftruncate(fd, 16) == 0, "failed to size shared memory!");
+
+        FdChannel *channel = FdChannel::connect(path);
+
+        JobRequest attach{};
+        attach.op = JobAttach;
+        attach.count = JOB_CAPACITY;
+
+        channel->send(&attach, sizeof(attach), {fd});
+        close(fd);
+
+        JobReply reply{};
+        channel->receive(&reply, sizeof(reply));
+
+        channel->release();
+        delete channel;
+
+        check(reply.status != 0, "server attached a region smaller than its size!");
+    }
+    catch (...)
+    {
+        server.stop();
+        executor.join();
+        server.release();
+        throw;
+    }
+
+    server.stop();
+    executor.join();
+    server.release();
+}
+
+int main()
+{
+    std::string path = "/tmp/vkcompute-sharing-" + std::to_string(getpid()) + ".sock";
+
+    // fork before either process touches Vulkan
+    pid_t child = fork();
+
+    if (child == 0)
+    {
+        try
+        {
+            _exit(consumer(path));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "consumer: " << e.what() << std::endl;
+            _exit(EXIT_FAILURE);
+        }
+    }
+
+    try
+    {
+        check(child > 0, "failed to fork!");
+
+        FdChannel *channel = FdChannel::accept(path);
+
+        VulkanContext::Instance().initialize();
+
+        char supported = 0;
+        channel->receive(&supported, 1);
+
+        if (!supported || !isSupported())
+        {
+            std::cout << "external memory fd is not supported, skipped" << std::endl;
+        }
+        else
+        {
+            ComputeShader *cs = new ComputeShader("../res/shaders/ComputeShader.csv");
+            cs->setUniform("ParameterUBO", "deltaTime", 0.5f);
+
+            std::vector<Particle> particles(PARTICLE_COUNT);
+            for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+            {
+                particles[i] = {(float)i, 0.0f, 0.0f, 0.0f};
+            }
+
+            TypedComputeBuffer<Particle> *bufferIn = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
+            bufferIn->setData(particles);
+
+            ComputeBuffer *shared = ComputeBuffer::createExportable(PARTICLE_COUNT, sizeof(Particle), Dynamic);
+            SharedFence fence;
+
+            channel->sendBuffer(shared, &fence);
+
+            cs->setBuffer("ParticleSSBOIn", bufferIn);
+            cs->setBuffer("ParticleSSBOOut", shared);
+            cs->dispatch(PARTICLE_COUNT / 256, 1, 1);
+            VulkanContext::Instance().compute();
+
+            fence.signal();
+
+            char done = 0;
+            channel->receive(&done, 1);
+
+            fence.release();
+            shared->release();
+            delete shared;
+            bufferIn->release();
+            cs->release();
+        }
+
+        channel->release();
+        delete channel;
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        check(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "consumer process failed!");
+
+        jobs();
+
+        VulkanContext::Instance().release();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/StreamExecutor.h"
+#include "../VkCompute/Metrics.h"
+#include "../VkCompute/ComputeBuffer.h"
+#include "../VkCompute/AsyncReadback.h"
+#include <random>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+const size_t PARTICLE_COUNT = 1000000;
+const int CHUNK_COUNT = 65536;
+
+struct Particle
+{
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+int main()
+{
+    try
+    {
+        VulkanContext::Instance().initialize();
+
+        ComputeShader* cs = new ComputeShader("../res/shaders/ComputeShader.csv");
+        cs->setUniform("ParameterUBO", 0.5f);
+
+        std::vector<Particle> particlesIn(PARTICLE_COUNT);
+        std::vector<Particle> particlesOut(PARTICLE_COUNT);
+
+        std::default_random_engine rndEngine((unsigned)time(nullptr));
+        std::uniform_real_distribution<float> rndDist(0.0f, 1.0f);
+
+        for (auto &particle : particlesIn)
+        {
+            particle = {rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine), rndDist(rndEngine)};
+        }
+
+        for (int depth = 2; depth <= 3; ++depth)
+        {
+            StreamExecutor* stream = new StreamExecutor(cs, "ParticleSSBOIn", "ParticleSSBOOut", CHUNK_COUNT, sizeof(Particle), sizeof(Particle), depth);
+            stream->calibrate();
+
+            StreamStats stats = stream->run(particlesIn.data(), particlesOut.data(), PARTICLE_COUNT);
+
+            std::cout << "depth " << depth << std::endl;
+            stats.report(std::cout);
+
+            for (size_t i = 0; i != PARTICLE_COUNT; ++i)
+            {
+                if (std::fabs(particlesOut[i].r - (particlesIn[i].r + 0.5f)) > 1e-5f ||
+                    std::fabs(particlesOut[i].a - (particlesIn[i].a + 0.5f)) > 1e-5f)
+                {
+                    std::cerr << "mismatch at " << i << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            stream->release();
+            delete stream;
+        }
+
+        // a region starting inside a page, loaded straight into host visible and device local memory
+        const char* filename = "vkcompute-file-test.bin";
+        const uint64_t FILE_FLOATS = 300000;
+        const uint64_t REGION_FIRST = 1027;
+        const uint64_t REGION_COUNT = 200000;
+
+        std::vector<float> contents(FILE_FLOATS);
+        for (uint64_t i = 0; i != FILE_FLOATS; ++i)
+        {
+            contents[i] = (float)i * 0.25f;
+        }
+
+        std::ofstream file(filename, std::ios::binary);
+        file.write((const char*)contents.data(), contents.size() * sizeof(float));
+        file.close();
+
+        for (ComputeBufferMode mode : {Dynamic, DeviceLocal})
+        {
+            ComputeBuffer* loaded = ComputeBuffer::createFromFile(filename, sizeof(float), mode, REGION_FIRST * sizeof(float), REGION_COUNT * sizeof(float));
+
+            std::vector<char> bytes = loaded->readAsync(loaded->getCount()).get();
+            const float* values = (const float*)bytes.data();
+
+            if (loaded->getCount() != REGION_COUNT || values[0] != contents[REGION_FIRST] || values[REGION_COUNT - 1] != contents[REGION_FIRST + REGION_COUNT - 1])
+            {
+                std::cerr << "file region loaded wrong in mode " << mode << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            // a range in the middle through both readback overloads
+            const uint64_t RANGE_FIRST = 4099;
+            const uint64_t RANGE_COUNT = 777;
+
+            std::vector<char> range = loaded->readAsync(RANGE_COUNT, RANGE_FIRST).get();
+            std::vector<float> called;
+
+            loaded->readAsync(RANGE_COUNT, RANGE_FIRST, [&called](const void *data, size_t size)
+            {
+                called.assign((const float*)data, (const float*)data + size / sizeof(float));
+            });
+            AsyncReadback::Instance().flush();
+
+            const float* rangeValues = (const float*)range.data();
+
+            if (range.size() != RANGE_COUNT * sizeof(float) || called.size() != RANGE_COUNT ||
+                rangeValues[0] != contents[REGION_FIRST + RANGE_FIRST] || called[RANGE_COUNT - 1] != contents[REGION_FIRST + RANGE_FIRST + RANGE_COUNT - 1])
+            {
+                std::cerr << "range readback wrong in mode " << mode << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            bool rejected = false;
+            try
+            {
+                loaded->readAsync(2, REGION_COUNT - 1);
+            }
+            catch (const std::runtime_error&)
+            {
+                rejected = true;
+            }
+
+            if (!rejected)
+            {
+                std::cerr << "readback past the end was accepted" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            loaded->release();
+            delete loaded;
+        }
+
+        std::remove(filename);
+
+        MetricsSnapshot metrics = Metrics::Instance().snapshot();
+
+        if (metrics.submits == 0 || metrics.fenceWaits == 0 || metrics.allocations <= metrics.frees)
+        {
+            std::cerr << "metrics were not recorded" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Metrics::Instance().exportPrometheus("vkcompute-metrics.prom");
+
+        cs->release();
+
+        VulkanContext::Instance().release();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
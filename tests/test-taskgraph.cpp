@@ -0,0 +1,144 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/TypedComputeBuffer.h"
+#include "../VkCompute/TaskGraph.h"
+#include <iostream>
+#include <vector>
+
+const uint32_t PARTICLE_COUNT = 8192;
+
+struct Particle
+{
+    float r;
+    float g;
+    float b;
+    float a;
+};
+
+STD430_STRUCT(Particle, float, float, float, float);
+
+void check(bool condition, const char *message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+int main()
+{
+    try
+    {
+        VulkanContext::Instance().initialize();
+
+        // every stage adds deltaTime to its input
+        std::vector<ComputeShader *> shaders;
+        for (int i = 0; i != 4; ++i)
+        {
+            shaders.push_back(new ComputeShader("../res/shaders/ComputeShader.csv"));
+        }
+        shaders[0]->setUniform("ParameterUBO", "deltaTime", 0.5f);
+
+        std::vector<Particle> particles(PARTICLE_COUNT);
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            particles[i] = {(float)i, 1.0f, 2.0f, 3.0f};
+        }
+
+        std::vector<TypedComputeBuffer<Particle> *> buffers;
+        for (int i = 0; i != 4; ++i)
+        {
+            buffers.push_back(new TypedComputeBuffer<Particle>(PARTICLE_COUNT));
+        }
+        TypedComputeBuffer<Particle> *a = buffers[0], *b = buffers[1], *c = buffers[2], *d = buffers[3];
+        a->setData(particles);
+
+        TaskGraph graph;
+
+        // a -> b and a -> c are independent, b -> d needs b, c -> a must wait for both readers of a
+        shaders[0]->setBuffer("ParticleSSBOIn", a);
+        shaders[0]->setBuffer("ParticleSSBOOut", b);
+        int ab = graph.add(shaders[0], PARTICLE_COUNT / 256, 1, 1);
+
+        shaders[1]->setBuffer("ParticleSSBOIn", a);
+        shaders[1]->setBuffer("ParticleSSBOOut", c);
+        int ac = graph.add(shaders[1], PARTICLE_COUNT / 256, 1, 1);
+
+        shaders[2]->setBuffer("ParticleSSBOIn", b);
+        shaders[2]->setBuffer("ParticleSSBOOut", d);
+        int bd = graph.add(shaders[2], PARTICLE_COUNT / 256, 1, 1);
+
+        shaders[3]->setBuffer("ParticleSSBOIn", c);
+        shaders[3]->setBuffer("ParticleSSBOOut", a);
+        int ca = graph.add(shaders[3], PARTICLE_COUNT / 256, 1, 1);
+
+        check(graph.getLevel(ab) == 0 && graph.getLevel(ac) == 0, "independent tasks must share the first level");
+        check(graph.getLevel(bd) == 1 && graph.getLevel(ca) == 1, "dependent tasks must run in the second level");
+        check(graph.getDependencies(ca).size() == 2, "write after read must wait for both readers");
+
+        graph.run();
+
+        check(graph.getLevelCount() == 2 && graph.getBarrierCount() == 1, "expected a single barrier");
+
+        std::vector<Particle> result(PARTICLE_COUNT);
+
+        d->getData(result);
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            check(result[i].r == (float)i + 1.0f && result[i].a == 4.0f, "read after write through b produced wrong results");
+        }
+
+        a->getData(result);
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            check(result[i].r == (float)i + 1.0f && result[i].g == 2.0f, "write after read of a produced wrong results");
+        }
+
+        std::cout << "levels: " << graph.getLevelCount() << ", barriers: " << graph.getBarrierCount() << std::endl;
+
+        graph.release();
+
+        // more snapshots of one shader than a single descriptor pool holds
+        const int CHAIN_LENGTH = 40;
+        a->setData(particles);
+
+        TaskGraph chain;
+
+        for (int i = 0; i != CHAIN_LENGTH; ++i)
+        {
+            shaders[0]->setBuffer("ParticleSSBOIn", i % 2 == 0 ? a : b);
+            shaders[0]->setBuffer("ParticleSSBOOut", i % 2 == 0 ? b : a);
+            chain.add(shaders[0], PARTICLE_COUNT / 256, 1, 1);
+        }
+
+        chain.run();
+
+        check(chain.getLevelCount() == CHAIN_LENGTH, "every link of the chain needs its own level");
+
+        a->getData(result);
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            check(result[i].r == (float)i + CHAIN_LENGTH * 0.5f && result[i].a == 3.0f + CHAIN_LENGTH * 0.5f, "long chain produced wrong results");
+        }
+
+        chain.release();
+
+        for (auto buffer : buffers)
+        {
+            buffer->release();
+        }
+
+        for (auto shader : shaders)
+        {
+            shader->release();
+        }
+
+        VulkanContext::Instance().release();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,7 +1,20 @@
 #include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/TypedComputeBuffer.h"
+#include "../VkCompute/ComputeProgram.h"
+#include "../VkCompute/IterativeSolver.h"
+#include "../VkCompute/ResidencyManager.h"
+#include "../VkCompute/ComputeImage.h"
+#include "../VkCompute/ComputeBufferView.h"
+#include "../VkCompute/RandomGenerator.h"
+#include "../VkCompute/BindlessHeap.h"
+#include "../VkCompute/ShaderLibrary.h"
 #include <random>
 #include <iostream>
 #include <array>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 
 const uint32_t PARTICLE_COUNT = 8192;
 
@@ -13,6 +26,28 @@ struct Particle
     float a;
 };
 
+STD430_STRUCT(Particle, float, float, float, float);
+
+// a struct member keeps its alignment and its padded size, std430 puts tail behind all 16 bytes of sample
+struct Sample
+{
+    std430::vec2 uv;
+    float weight;
+};
+
+struct Tap
+{
+    Sample sample;
+    float tail;
+    std430::vec4 color;
+};
+
+STD430_STRUCT(Sample, std430::vec2, float);
+STD430_STRUCT(Tap, Sample, float, std430::vec4);
+STD430_OFFSET(Tap, tail, 16);
+STD430_OFFSET(Tap, color, 32);
+static_assert(std430::stride<Sample>() == 16 && std430::stride<Tap>() == 48, "nested std430 structs have the wrong stride");
+
 // Initialize particles
 void initParticles(std::vector<Particle>& particles)
 {
@@ -30,22 +65,71 @@ void initParticles(std::vector<Particle>& particles)
     }
 }
 
+// word index of the sequence (seed, stream) as Random.comp draws it
+uint32_t randomWord(uint64_t seed, uint32_t stream, uint64_t index)
+{
+    const uint32_t counter[4] = {(uint32_t)(index >> 2), (uint32_t)(index >> 34), stream, 0};
+    const uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+    uint32_t words[4];
+    RandomGenerator::philox(counter, key, words);
+    return words[index & 3];
+}
+
 int main()
 {
     try
     {
+        // Random123 known answers for Philox4x32-10, the sequence Random.comp and Philox.glsl produce
+        const uint32_t counter[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+        const uint32_t key[2] = {0xa4093822, 0x299f31d0};
+        uint32_t words[4];
+        RandomGenerator::philox(counter, key, words);
+
+        if (words[0] != 0xd16cfe09 || words[1] != 0x94fdcceb || words[2] != 0x5001e420 || words[3] != 0x24126ea1)
+        {
+            throw std::runtime_error("philox does not match its known answer!");
+        }
+
         VulkanContext::Instance().initialize();
 
+        // std140 offsets: vec3 aligns to 16 but leaves its last 4 bytes to the next scalar,
+        // array elements and mat4 take whole 16 byte slots
+        UniformData::Instance().addUniform("LayoutCheck", "float a;vec3 b;float c;float d[3];float e;mat4 m;vec2 f");
+        const UniformBlock &layout = UniformData::Instance().getBlock("LayoutCheck");
+        const std::pair<const char *, uint32_t> offsets[] = {{"a", 0}, {"b", 16}, {"c", 28}, {"d", 32}, {"e", 80}, {"m", 96}, {"f", 160}};
+
+        for (const auto &expected : offsets)
+        {
+            if (layout.fields.at(expected.first).offset != expected.second)
+            {
+                throw std::runtime_error(std::string("wrong std140 offset for ") + expected.first + "!");
+            }
+        }
+
+        if (layout.fields.at("d").stride != 16 || layout.info.range != 176)
+        {
+            throw std::runtime_error("wrong std140 array stride or block size!");
+        }
+
+        // a one element array is still an array: 16 byte stride, the next scalar starts a new slot
+        UniformData::Instance().addUniform("SingleArrayCheck", "float x[1];float y");
+        const UniformBlock &single = UniformData::Instance().getBlock("SingleArrayCheck");
+
+        if (single.fields.at("x").stride != 16 || single.fields.at("y").offset != 16 || single.info.range != 32)
+        {
+            throw std::runtime_error("wrong std140 layout for a one element array!");
+        }
+
         VulkanContext::Instance().reset();
 
         ComputeShader* cs = new ComputeShader("../res/shaders/ComputeShader.csv");
 
-        cs->setUniform("ParameterUBO", 0.5f);
+        cs->setUniform("ParameterUBO", "deltaTime", 0.5f);
 
         std::vector<Particle> particles(PARTICLE_COUNT);
         initParticles(particles);
-        ComputeBuffer* bufferIn = new ComputeBuffer(PARTICLE_COUNT, sizeof(Particle));
-        bufferIn->setData(particles.data(), PARTICLE_COUNT);
+        TypedComputeBuffer<Particle>* bufferIn = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
+        bufferIn->setData(particles);
 
         for (int i = 0; i != 5; ++i)
         {
@@ -54,20 +138,594 @@ int main()
 
         cs->setBuffer("ParticleSSBOIn", bufferIn);
 
-        ComputeBuffer* bufferOut = new ComputeBuffer(PARTICLE_COUNT, sizeof(Particle));
+        TypedComputeBuffer<Particle>* bufferOut = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
         cs->setBuffer("ParticleSSBOOut", bufferOut);
 
         cs->dispatch(PARTICLE_COUNT / 256, 1, 1);
 
         VulkanContext::Instance().compute();
 
-        bufferOut->getData(particles.data(), PARTICLE_COUNT);
+        bufferOut->getData(particles);
 
         for (int i = 0; i != 5; ++i)
         {
             std::cout << i << ":\t" << particles[i].r << ", " << particles[i].g << ", " << particles[i].b << ", " << particles[i].a << std::endl;
         }
 
+        // record once, replay with only the uniform changing
+        ComputeProgram program;
+        program.begin();
+        program.dispatch(cs, PARTICLE_COUNT / 256, 1, 1);
+        program.end();
+
+        std::vector<Particle> source(PARTICLE_COUNT);
+        bufferIn->getData(source);
+
+        for (int run = 1; run <= 3; ++run)
+        {
+            cs->setUniform("ParameterUBO", "deltaTime", (float)run);
+            program.run();
+
+            bufferOut->getData(particles);
+
+            if (particles[0].r != source[0].r + (float)run || particles[PARTICLE_COUNT - 1].a != source[PARTICLE_COUNT - 1].a + (float)run)
+            {
+                throw std::runtime_error("program replay produced wrong results!");
+            }
+        }
+
+        // a uniform changed while a submission is in flight does not reach that submission
+        TypedComputeBuffer<Particle>* bufferLater = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
+        cs->setBuffer("ParticleSSBOOut", bufferLater);
+
+        ComputeProgram later;
+        later.begin();
+        later.dispatch(cs, PARTICLE_COUNT / 256, 1, 1);
+        later.end();
+
+        cs->setBuffer("ParticleSSBOOut", bufferOut);
+
+        cs->setUniform("ParameterUBO", "deltaTime", 4.0f);
+        program.submit();
+        cs->setUniform("ParameterUBO", "deltaTime", 5.0f);
+        later.submit();
+        program.wait();
+        later.wait();
+
+        std::vector<Particle> laterParticles(PARTICLE_COUNT);
+        bufferOut->getData(particles);
+        bufferLater->getData(laterParticles);
+
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            if (particles[i].g != source[i].g + 4.0f || laterParticles[i].g != source[i].g + 5.0f)
+            {
+                throw std::runtime_error("in-flight submission saw a later uniform value!");
+            }
+        }
+
+        later.release();
+        bufferLater->release();
+        program.release();
+
+        // ten ping-pong iterations in a single submit
+        cs->setUniform("ParameterUBO", "deltaTime", 0.25f);
+
+        IterativeSolver solver(cs, "ParticleSSBOIn", "ParticleSSBOOut", bufferIn, bufferOut, PARTICLE_COUNT / 256);
+        solver.record(10);
+
+        if (solver.run() != 10 || solver.getResult() != bufferIn)
+        {
+            throw std::runtime_error("solver ran the wrong number of iterations!");
+        }
+
+        bufferIn->getData(particles);
+
+        if (std::fabs(particles[0].r - (source[0].r + 2.5f)) > 1e-5f || std::fabs(particles[PARTICLE_COUNT - 1].a - (source[PARTICLE_COUNT - 1].a + 2.5f)) > 1e-5f)
+        {
+            throw std::runtime_error("solver produced wrong results!");
+        }
+
+        solver.release();
+
+        // Jacobi relaxation of a bump on a line, converges long before the recorded iterations run out
+        const uint32_t FIELD_COUNT = 1000;
+        const int MAX_ITERATIONS = 32;
+        const float TOLERANCE = 0.25f;
+
+        std::vector<float> field(FIELD_COUNT);
+        for (uint32_t i = 0; i != FIELD_COUNT; ++i)
+        {
+            field[i] = (float)i;
+        }
+        field[FIELD_COUNT / 2] += 1.0f;
+
+        ComputeShader* relax = new ComputeShader("../res/shaders/Relax.csv");
+        relax->setUniform("RelaxParams", "tolerance", TOLERANCE);
+        relax->setUniform("RelaxParams", "count", FIELD_COUNT);
+
+        ComputeBuffer* fieldA = new ComputeBuffer(FIELD_COUNT, sizeof(float), Dynamic);
+        ComputeBuffer* fieldB = new ComputeBuffer(FIELD_COUNT, sizeof(float), Dynamic);
+        fieldA->setData(field.data(), FIELD_COUNT);
+
+        IterativeSolver relaxation(relax, "RelaxIn", "RelaxOut", fieldA, fieldB, (FIELD_COUNT + 255) / 256, 1, 1, "SolverControl");
+        relaxation.record(MAX_ITERATIONS);
+        int relaxed = relaxation.run();
+
+        // the same steps on the host: every iteration runs until one finds all changes below the tolerance
+        int expected = 0;
+        bool converged = false;
+        std::vector<float> next(FIELD_COUNT);
+
+        while (expected != MAX_ITERATIONS && !converged)
+        {
+            converged = true;
+
+            for (uint32_t i = 0; i != FIELD_COUNT; ++i)
+            {
+                next[i] = i == 0 || i == FIELD_COUNT - 1 ? field[i] : 0.5f * (field[i - 1] + field[i + 1]);
+                converged = converged && std::fabs(next[i] - field[i]) < TOLERANCE;
+            }
+
+            field.swap(next);
+            ++expected;
+        }
+
+        if (relaxed >= MAX_ITERATIONS || relaxed != expected || relaxation.getResult() != (relaxed % 2 == 0 ? fieldA : fieldB))
+        {
+            throw std::runtime_error("relaxation did not stop when it converged!");
+        }
+
+        std::vector<float> relaxedField(FIELD_COUNT);
+        relaxation.getResult()->getData(relaxedField.data(), FIELD_COUNT);
+
+        if (relaxedField != field)
+        {
+            throw std::runtime_error("relaxation produced wrong results!");
+        }
+
+        relaxation.release();
+        fieldA->release();
+        fieldB->release();
+        relax->release();
+
+        // room for one of the two buffers, each dispatch swaps which one is on the device
+        ResidencyManager::Instance().manage(bufferIn);
+        ResidencyManager::Instance().manage(bufferOut);
+        ResidencyManager::Instance().setLimit(bufferIn->getSize());
+
+        cs->setUniform("ParameterUBO", "deltaTime", 1.0f);
+        cs->dispatch(PARTICLE_COUNT / 256, 1, 1);
+        VulkanContext::Instance().compute();
+
+        ResidencyManager::Instance().use({bufferIn});
+
+        if (bufferOut->isResident())
+        {
+            throw std::runtime_error("residency manager did not evict!");
+        }
+
+        bufferIn->getData(source);
+        bufferOut->getData(particles);
+
+        if (ResidencyManager::Instance().getRestores() == 0 || particles[0].r != source[0].r + 1.0f)
+        {
+            throw std::runtime_error("residency manager lost buffer contents!");
+        }
+
+        // paging other buffers in between recording and submitting must not evict what the dispatch recorded
+        TypedComputeBuffer<Particle>* extraIn = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
+        TypedComputeBuffer<Particle>* extraOut = new TypedComputeBuffer<Particle>(PARTICLE_COUNT);
+
+        ResidencyManager::Instance().manage(extraIn);
+        ResidencyManager::Instance().manage(extraOut);
+        ResidencyManager::Instance().setLimit(2 * bufferIn->getSize());
+
+        cs->setUniform("ParameterUBO", "deltaTime", 2.0f);
+
+        VulkanContext::Instance().reset();
+        cs->dispatch(PARTICLE_COUNT / 256, 1, 1);
+
+        extraIn->getData(particles);
+        extraOut->getData(particles);
+
+        if (!bufferIn->isResident() || !bufferOut->isResident())
+        {
+            throw std::runtime_error("residency manager evicted a recorded buffer!");
+        }
+
+        VulkanContext::Instance().compute();
+
+        bufferOut->getData(particles);
+
+        if (particles[0].r != source[0].r + 2.0f || particles[PARTICLE_COUNT - 1].a != source[PARTICLE_COUNT - 1].a + 2.0f)
+        {
+            throw std::runtime_error("residency manager lost recorded buffers!");
+        }
+
+        cs->setUniform("ParameterUBO", "deltaTime", 1.0f);
+
+        // a recorded program keeps its buffers resident until the recording is discarded
+        ComputeProgram pinned;
+        pinned.begin();
+        pinned.dispatch(cs, PARTICLE_COUNT / 256, 1, 1);
+        pinned.end();
+
+        ResidencyManager::Instance().setLimit(bufferIn->getSize());
+        extraIn->getData(particles);
+        extraOut->getData(particles);
+
+        if (!bufferIn->isResident() || !bufferOut->isResident())
+        {
+            throw std::runtime_error("residency manager evicted a buffer of a recorded program!");
+        }
+
+        pinned.run();
+        pinned.release();
+
+        ResidencyManager::Instance().unmanage(extraIn);
+        ResidencyManager::Instance().unmanage(extraOut);
+        extraIn->release();
+        extraOut->release();
+
+        ResidencyManager::Instance().setLimit(0);
+
+        // round trip through an optimally tiled image
+        ComputeImage image(64, PARTICLE_COUNT / 64);
+        image.setData(source.data());
+        image.getData(particles.data());
+
+        if (particles[0].r != source[0].r || particles[PARTICLE_COUNT - 1].a != source[PARTICLE_COUNT - 1].a)
+        {
+            throw std::runtime_error("image round trip lost data!");
+        }
+
+        // 3x3 box blur through the sampled input and the storage output, edges clamp
+        const int WIDTH = 64;
+        const int HEIGHT = PARTICLE_COUNT / 64;
+
+        ComputeImage blurred(WIDTH, HEIGHT);
+        ComputeShader* blur = new ComputeShader("../res/shaders/Blur.csv");
+        blur->setImage("BlurIn", &image);
+        blur->setImage("BlurOut", &blurred);
+        blur->dispatch(WIDTH / 16, HEIGHT / 16, 1);
+        VulkanContext::Instance().compute();
+
+        blurred.getData(particles.data());
+
+        for (int y = 0; y != HEIGHT; ++y)
+        {
+            for (int x = 0; x != WIDTH; ++x)
+            {
+                float sum[4] = {};
+
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        const Particle &texel = source[std::min(std::max(y + dy, 0), HEIGHT - 1) * WIDTH + std::min(std::max(x + dx, 0), WIDTH - 1)];
+                        sum[0] += texel.r;
+                        sum[1] += texel.g;
+                        sum[2] += texel.b;
+                        sum[3] += texel.a;
+                    }
+                }
+
+                const Particle &pixel = particles[y * WIDTH + x];
+                const float result[4] = {pixel.r, pixel.g, pixel.b, pixel.a};
+
+                for (int c = 0; c != 4; ++c)
+                {
+                    if (std::fabs(result[c] - sum[c] / 9.0f) > 1e-5f)
+                    {
+                        throw std::runtime_error("blur produced wrong results!");
+                    }
+                }
+            }
+        }
+
+        blur->release();
+        blurred.release();
+        image.release();
+
+        // clear the output on the device, then run the kernel over the second half of the input only
+        const int HALF = PARTICLE_COUNT / 2;
+
+        ComputeProgram clear;
+        clear.begin();
+        clear.fill(bufferOut, 0);
+        clear.end();
+        clear.run();
+        clear.release();
+
+        cs->setBuffer("ParticleSSBOIn", ComputeBufferView(bufferIn, HALF, HALF));
+        cs->setBuffer("ParticleSSBOOut", ComputeBufferView(bufferOut, 0, HALF));
+        cs->dispatch(HALF / 256, 1, 1);
+        VulkanContext::Instance().compute();
+
+        bufferOut->getData(particles);
+
+        if (particles[0].r != source[HALF].r + 1.0f || particles[HALF].r != 0.0f)
+        {
+            throw std::runtime_error("buffer views or fill produced wrong results!");
+        }
+
+        // copies inside one buffer are fine as long as the regions stay apart
+        ComputeProgram copy;
+        copy.begin();
+        copy.barrier();
+        copy.copy(ComputeBufferView(bufferOut, 0, HALF), ComputeBufferView(bufferOut, HALF, HALF));
+
+        bool overlapped = false;
+
+        try
+        {
+            copy.copy(ComputeBufferView(bufferOut, 0, HALF), ComputeBufferView(bufferOut, HALF - 1, HALF));
+        }
+        catch (const std::runtime_error &)
+        {
+            overlapped = true;
+        }
+
+        copy.end();
+        copy.run();
+        copy.release();
+
+        bufferOut->getData(particles);
+
+        if (!overlapped || particles[HALF].r != source[HALF].r + 1.0f || particles[PARTICLE_COUNT - 1].a != particles[HALF - 1].a)
+        {
+            throw std::runtime_error("copy inside one buffer produced wrong results!");
+        }
+
+        // whole buffers in bindable chunks, views never straddle a workgroup
+        std::vector<ComputeBufferView> chunks = ComputeBufferView::split(bufferIn, 1000, 256);
+
+        if (chunks.size() != (PARTICLE_COUNT + 767) / 768 || chunks[1].getFirst() != 768 || chunks.back().getFirst() + chunks.back().getCount() != PARTICLE_COUNT)
+        {
+            throw std::runtime_error("buffer split produced wrong views!");
+        }
+
+        // chunks of 2816, 2816 and 2560 elements, every element checked so neither the seams nor the tail are missed
+        cs->dispatchChunked({{"ParticleSSBOIn", bufferIn}, {"ParticleSSBOOut", bufferOut}}, PARTICLE_COUNT, 256, 3000);
+        bufferOut->getData(particles);
+
+        for (uint32_t i = 0; i != PARTICLE_COUNT; ++i)
+        {
+            if (particles[i].r != source[i].r + 1.0f || particles[i].g != source[i].g + 1.0f ||
+                particles[i].b != source[i].b + 1.0f || particles[i].a != source[i].a + 1.0f)
+            {
+                throw std::runtime_error("chunked dispatch produced wrong results!");
+            }
+        }
+
+        bool unaligned = false;
+
+        try
+        {
+            cs->dispatchChunked({{"ParticleSSBOIn", bufferIn}, {"ParticleSSBOOut", bufferOut}}, PARTICLE_COUNT - 1, 256);
+        }
+        catch (const std::runtime_error &)
+        {
+            unaligned = true;
+        }
+
+        if (!unaligned)
+        {
+            throw std::runtime_error("chunked dispatch accepted a partial workgroup!");
+        }
+
+        // both buffers are picked from the heap by push constants, nothing is bound to the shader itself
+        if (BindlessHeap::Instance().isAvailable())
+        {
+            const uint32_t VECTOR_COUNT = 1000;
+
+            struct BindlessAddArgs
+            {
+                uint32_t src;
+                uint32_t dst;
+                uint32_t count;
+                float value;
+            };
+
+            std::vector<float> vectors(VECTOR_COUNT * 4);
+            for (size_t i = 0; i != vectors.size(); ++i)
+            {
+                vectors[i] = (float)i * 0.25f;
+            }
+
+            ComputeBuffer* bindlessIn = new ComputeBuffer(VECTOR_COUNT, 16, Dynamic);
+            ComputeBuffer* bindlessOut = new ComputeBuffer(VECTOR_COUNT, 16, Dynamic);
+            bindlessIn->setData(vectors.data(), VECTOR_COUNT);
+
+            ComputeShader* bindless = new ComputeShader("../res/shaders/BindlessAdd.csv");
+            bindless->setPushConstants(BindlessAddArgs{bindlessIn->getBindlessIndex(), bindlessOut->getBindlessIndex(), VECTOR_COUNT, 1.5f});
+            bindless->dispatch((VECTOR_COUNT + 255) / 256, 1, 1);
+            VulkanContext::Instance().compute();
+
+            std::vector<float> added(VECTOR_COUNT * 4);
+            bindlessOut->getData(added.data(), VECTOR_COUNT);
+
+            for (size_t i = 0; i != added.size(); ++i)
+            {
+                if (added[i] != vectors[i] + 1.5f)
+                {
+                    throw std::runtime_error("bindless dispatch produced wrong results!");
+                }
+            }
+
+            // a limit below both buffers must not evict what the heap still points at
+            ResidencyManager::Instance().manage(bindlessIn);
+            ResidencyManager::Instance().manage(bindlessOut);
+            ResidencyManager::Instance().setLimit(bindlessIn->getSize());
+
+            if (!bindlessIn->isResident() || !bindlessOut->isResident() || ResidencyManager::Instance().evict(2 * bindlessIn->getSize()) != 0)
+            {
+                throw std::runtime_error("residency manager evicted a bindless buffer!");
+            }
+
+            bool refused = false;
+
+            try
+            {
+                bindlessOut->evict();
+            }
+            catch (const std::runtime_error &)
+            {
+                refused = true;
+            }
+
+            if (!refused)
+            {
+                throw std::runtime_error("bindless buffer was evicted!");
+            }
+
+            bindless->setPushConstants(BindlessAddArgs{bindlessIn->getBindlessIndex(), bindlessOut->getBindlessIndex(), VECTOR_COUNT, 2.5f});
+            bindless->dispatch((VECTOR_COUNT + 255) / 256, 1, 1);
+            VulkanContext::Instance().compute();
+
+            bindlessOut->getData(added.data(), VECTOR_COUNT);
+
+            for (size_t i = 0; i != added.size(); ++i)
+            {
+                if (added[i] != vectors[i] + 2.5f)
+                {
+                    throw std::runtime_error("bindless dispatch under a residency limit produced wrong results!");
+                }
+            }
+
+            ResidencyManager::Instance().setLimit(0);
+
+            bindless->release();
+            bindlessIn->release();
+            bindlessOut->release();
+        }
+        else
+        {
+            std::cout << "descriptor indexing unsupported, skipping the bindless dispatch" << std::endl;
+        }
+
+        // device fills against the host Philox, from an unaligned position and split into two fills of one sequence
+        {
+            const uint64_t SEED = 0x0123456789abcdefull;
+            const uint32_t STREAM = 7;
+            const uint64_t POSITION = (1ull << 33) + 4097;
+            const uint32_t RANDOM_COUNT = 10000, FIRST_CHUNK = 3333;
+
+            RandomGenerator random(SEED, STREAM);
+            ComputeBuffer *whole = new ComputeBuffer(RANDOM_COUNT, 4, Dynamic);
+            ComputeBuffer *head = new ComputeBuffer(FIRST_CHUNK, 4, Dynamic);
+            ComputeBuffer *tail = new ComputeBuffer(RANDOM_COUNT - FIRST_CHUNK, 4, Dynamic);
+
+            std::vector<uint32_t> words(RANDOM_COUNT), split(RANDOM_COUNT);
+
+            auto fetch = [&]()
+            {
+                whole->getData(words.data(), RANDOM_COUNT);
+                head->getData(split.data(), FIRST_CHUNK);
+                tail->getData(split.data() + FIRST_CHUNK, RANDOM_COUNT - FIRST_CHUNK);
+            };
+
+            // a power of two range keeps low + u * (high - low) exact with or without a fused multiply add
+            random.uniform(whole, -2.0f, 2.0f, POSITION);
+            random.uniform(head, -2.0f, 2.0f, POSITION);
+            random.uniform(tail, -2.0f, 2.0f, POSITION + FIRST_CHUNK);
+            fetch();
+
+            for (uint32_t i = 0; i != RANDOM_COUNT; ++i)
+            {
+                float expected = std::min(-2.0f + (float)(randomWord(SEED, STREAM, POSITION + i) >> 8) * (1.0f / 16777216.0f) * 4.0f, std::nextafter(2.0f, -2.0f));
+                float value, part;
+                memcpy(&value, &words[i], sizeof(value));
+                memcpy(&part, &split[i], sizeof(part));
+
+                if (value != expected || part != expected)
+                {
+                    throw std::runtime_error("uniform fill does not match the host generator!");
+                }
+            }
+
+            random.integers(whole, -5, 5, POSITION);
+            random.integers(head, -5, 5, POSITION);
+            random.integers(tail, -5, 5, POSITION + FIRST_CHUNK);
+            fetch();
+
+            for (uint32_t i = 0; i != RANDOM_COUNT; ++i)
+            {
+                int32_t expected = -5 + (int32_t)(((uint64_t)randomWord(SEED, STREAM, POSITION + i) * 11u) >> 32);
+
+                if ((int32_t)words[i] != expected || (int32_t)split[i] != expected)
+                {
+                    throw std::runtime_error("integer fill does not match the host generator!");
+                }
+            }
+
+            whole->release();
+            head->release();
+            tail->release();
+            random.release();
+        }
+
+        // the kernel writes straight into an imported host allocation
+        Particle* hostOut = (Particle*)ComputeBuffer::allocateHost(PARTICLE_COUNT * sizeof(Particle));
+        ComputeBuffer* imported = new ComputeBuffer(hostOut, PARTICLE_COUNT, sizeof(Particle));
+
+        cs->setBuffer("ParticleSSBOIn", bufferIn);
+        cs->setBuffer("ParticleSSBOOut", imported);
+        cs->dispatch(PARTICLE_COUNT / 256, 1, 1);
+        VulkanContext::Instance().compute();
+
+        if (!imported->isImported())
+        {
+            std::cout << "host pointer import unsupported, checking the copy fallback" << std::endl;
+            imported->getData(hostOut, PARTICLE_COUNT);
+        }
+
+        if (hostOut[0].r != source[0].r + 1.0f || hostOut[PARTICLE_COUNT - 1].a != source[PARTICLE_COUNT - 1].a + 1.0f)
+        {
+            throw std::runtime_error("imported host memory holds wrong results!");
+        }
+
+        imported->release();
+        delete imported;
+        ComputeBuffer::freeHost(hostOut);
+
+        // every shader of the tree ships its SPIR-V and builds a pipeline
+        {
+            ShaderLibrary library("../res/shaders/");
+            size_t shaderCount = 0;
+
+            for (const auto &entry : std::filesystem::directory_iterator("../res/shaders/"))
+            {
+                shaderCount += entry.path().extension() == ".csv" ? 1 : 0;
+            }
+
+            if (library.names().size() != shaderCount)
+            {
+                throw std::runtime_error("shader library skipped shaders of the directory!");
+            }
+
+            for (const std::string &name : library.names())
+            {
+                // bindless shaders only load where the heap exists
+                if (name == "BindlessAdd" && !BindlessHeap::Instance().isAvailable())
+                {
+                    continue;
+                }
+
+                try
+                {
+                    library.get(name);
+                }
+                catch (const std::exception &e)
+                {
+                    throw std::runtime_error(name + " failed to load: " + e.what());
+                }
+            }
+
+            library.release();
+        }
+
         bufferIn->release();
         bufferOut->release();
         cs->release();
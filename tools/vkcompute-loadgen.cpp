@@ -0,0 +1,216 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/JobServer.h"
+#include "../VkCompute/JobClient.h"
+#include <iostream>
+#include <random>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// vkcompute-loadgen [socket] [clients] [jobs per client] [max job length] [--spawn]
+// Fake client processes sending a mix of add and sum jobs of random length to a JobServer.
+// --spawn starts the server in a child process first, so everything runs locally.
+
+static int serve(const std::string &path)
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    VulkanContext::Instance().initialize();
+
+    JobServer server(path);
+
+    std::thread([&server, signals]
+    {
+        int signal = 0;
+        sigwait(&signals, &signal);
+        server.stop();
+    }).detach();
+
+    server.run();
+    server.release();
+
+    VulkanContext::Instance().release();
+
+    return EXIT_SUCCESS;
+}
+
+static int client(const std::string &path, int index, int jobs, uint32_t maxLength)
+{
+    JobClient jobClient(path, maxLength);
+    float *data = jobClient.data();
+
+    std::default_random_engine engine((unsigned)index);
+    std::uniform_int_distribution<uint32_t> lengths(1, maxLength);
+    std::vector<double> latencies;
+
+    for (int job = 0; job != jobs; ++job)
+    {
+        uint32_t count = lengths(engine);
+
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            data[i] = (float)(i % 64);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (job % 2 == 0)
+        {
+            jobClient.add(0, count, 1.5f);
+
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                if (data[i] != (float)(i % 64) + 1.5f)
+                {
+                    throw std::runtime_error("add job returned wrong data!");
+                }
+            }
+        }
+        else
+        {
+            double expected = 0.0;
+
+            for (uint32_t i = 0; i != count; ++i)
+            {
+                expected += (double)(i % 64);
+            }
+
+            JobReply reply = jobClient.sum(0, count);
+
+            if (std::fabs(reply.result - expected) > 1e-4 * std::max(1.0, expected))
+            {
+                throw std::runtime_error("sum job returned a wrong result!");
+            }
+        }
+
+        latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "client " << index << ": " << jobs << " jobs, round trip p50/p99 ms: "
+              << latencies[latencies.size() / 2] * 1e3 << " " << latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)] * 1e3 << std::endl;
+
+    jobClient.release();
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args;
+    bool spawn = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--spawn") == 0)
+        {
+            spawn = true;
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    std::string path = args.size() > 0 ? args[0] : "/tmp/vkcompute.sock";
+    int clients = args.size() > 1 ? atoi(args[1].c_str()) : 8;
+    int jobs = args.size() > 2 ? atoi(args[2].c_str()) : 1000;
+    uint32_t maxLength = args.size() > 3 ? (uint32_t)atol(args[3].c_str()) : 4096;
+
+    if (clients <= 0 || jobs <= 0 || maxLength == 0)
+    {
+        std::cerr << "usage: vkcompute-loadgen [socket] [clients] [jobs per client] [max job length] [--spawn]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    pid_t server = -1;
+
+    if (spawn)
+    {
+        server = fork();
+
+        if (server == 0)
+        {
+            try
+            {
+                _exit(serve(path));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "server: " << e.what() << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    std::vector<pid_t> children;
+
+    for (int i = 0; i != clients; ++i)
+    {
+        pid_t child = fork();
+
+        if (child == 0)
+        {
+            try
+            {
+                _exit(client(path, i, jobs, maxLength));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "client " << i << ": " << e.what() << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+        }
+
+        children.push_back(child);
+    }
+
+    int failures = 0;
+
+    for (pid_t child : children)
+    {
+        int status = 0;
+        waitpid(child, &status, 0);
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            failures++;
+        }
+    }
+
+    try
+    {
+        JobClient statsClient(path, 1);
+        JobServerStats stats = statsClient.stats();
+        statsClient.release();
+
+        std::cout << "server: " << stats.jobs << " jobs in " << stats.batches << " batches, "
+                  << (stats.batches != 0 ? (double)stats.jobs / stats.batches : 0.0) << " jobs per batch" << std::endl;
+        std::cout << "queue   p50/p90/p99 ms: " << stats.queueSeconds[0] * 1e3 << " " << stats.queueSeconds[1] * 1e3 << " " << stats.queueSeconds[2] * 1e3 << std::endl;
+        std::cout << "execute p50/p90/p99 ms: " << stats.executeSeconds[0] * 1e3 << " " << stats.executeSeconds[1] * 1e3 << " " << stats.executeSeconds[2] * 1e3 << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        failures++;
+    }
+
+    if (server > 0)
+    {
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+    }
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
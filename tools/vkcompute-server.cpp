@@ -0,0 +1,54 @@
+#include "../VkCompute/VulkanContext.h"
+#include "../VkCompute/JobServer.h"
+#include <iostream>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
+#include <pthread.h>
+
+// vkcompute-server [socket] [max batch] [batch window in microseconds]
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : "/tmp/vkcompute.sock";
+    size_t maxBatch = argc > 2 ? (size_t)atol(argv[2]) : 4096;
+    double batchWindow = argc > 3 ? atof(argv[3]) * 1e-6 : 0.0005;
+
+    // SIGINT and SIGTERM are taken by a thread that stops the server, block them before any thread starts
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try
+    {
+        VulkanContext::Instance().initialize();
+
+        JobServer server(path, maxBatch, batchWindow);
+
+        std::thread([&server, signals]
+        {
+            int signal = 0;
+            sigwait(&signals, &signal);
+            server.stop();
+        }).detach();
+
+        std::cout << "serving on " << path << std::endl;
+        server.run();
+
+        JobServerStats stats = server.getStats();
+        std::cout << stats.jobs << " jobs in " << stats.batches << " batches" << std::endl;
+        std::cout << "queue   p50/p90/p99 ms: " << stats.queueSeconds[0] * 1e3 << " " << stats.queueSeconds[1] * 1e3 << " " << stats.queueSeconds[2] * 1e3 << std::endl;
+        std::cout << "execute p50/p90/p99 ms: " << stats.executeSeconds[0] * 1e3 << " " << stats.executeSeconds[1] * 1e3 << " " << stats.executeSeconds[2] * 1e3 << std::endl;
+
+        server.release();
+        VulkanContext::Instance().release();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}